@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+# Copyright (c) 2014 Chilean Krypto-Miners.
+# Distributed under the MIT/X11 software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+"""Shares verified per second from an asyncio event loop, with getPoWHash
+through run_in_executor and with AsyncPoW, which hashes on its own threads
+and in SIMD groups. Also prints the longest stall of the event loop, measured
+by a task that wakes up every millisecond.
+
+usage: bench_async.py [shares] [threads]
+"""
+
+import asyncio
+import os
+import struct
+import sys
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+import kshake320_hash
+
+
+async def _ticker(stalls, stop):
+    last = time.perf_counter()
+    while not stop.is_set():
+        await asyncio.sleep(0.001)
+        now = time.perf_counter()
+        stalls.append(now - last - 0.001)
+        last = now
+
+
+async def run(verify, headers):
+    stalls, stop = [], asyncio.Event()
+    ticker = asyncio.ensure_future(_ticker(stalls, stop))
+    start = time.perf_counter()
+    await asyncio.gather(*[verify(h) for h in headers])
+    elapsed = time.perf_counter() - start
+    stop.set()
+    await ticker
+    return len(headers) / elapsed, max(stalls or [0]) * 1e3
+
+
+async def main():
+    shares = int(sys.argv[1]) if len(sys.argv) > 1 else 2000
+    threads = int(sys.argv[2]) if len(sys.argv) > 2 else (os.cpu_count() or 1)
+    headers = [struct.pack("<i", 1 + i % 2) + os.urandom(116) for i in range(shares)]
+    loop = asyncio.get_running_loop()
+
+    executor = ThreadPoolExecutor(threads)
+    pool = kshake320_hash.AsyncPoW(threads)
+    cases = [
+        ("run_in_executor", lambda h: loop.run_in_executor(executor, kshake320_hash.getPoWHash, h)),
+        ("AsyncPoW", pool.hash),
+    ]
+    print("backend: %s, threads: %d, shares: %d" % (kshake320_hash.getBackend(), threads, shares))
+    print("%-16s %12s %14s" % ("", "shares/s", "max stall ms"))
+    for name, verify in cases:
+        rate, stall = await run(verify, headers)
+        print("%-16s %12.0f %14.1f" % (name, rate, stall))
+    pool.close()
+    executor.shutdown()
+
+
+if __name__ == '__main__':
+    asyncio.run(main())
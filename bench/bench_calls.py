@@ -0,0 +1,53 @@
+#!/usr/bin/env python
+# Copyright (c) 2014 Chilean Krypto-Miners.
+# Distributed under the MIT/X11 software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+"""Cost of one call to the hash functions on short inputs, where argument
+parsing and result allocation weigh the most. Prints the best of several
+timeit runs in nanoseconds per call.
+
+usage: bench_calls.py [calls_per_run]
+"""
+
+from __future__ import print_function
+
+import os
+import sys
+import timeit
+
+import kshake320_hash
+
+
+def best_ns(stmt, number, repeat=7):
+    return min(timeit.repeat(stmt, number=number, repeat=repeat)) / number * 1e9
+
+
+def main():
+    number = int(sys.argv[1]) if len(sys.argv) > 1 else 20000
+
+    header = os.urandom(120)
+    short = os.urandom(80)
+    out40 = bytearray(40)
+    out32 = bytearray(32)
+    f320 = kshake320_hash.getHash320
+    f256 = kshake320_hash.getHash256
+    fpow = kshake320_hash.getPoWHash
+    cases = [
+        ("getHash256(80 B)", lambda: f256(short), number),
+        ("getHash256(80 B, out)", lambda: f256(short, out=out32), number),
+        ("getHash320(80 B)", lambda: f320(short), number),
+        ("getHash320(80 B, out)", lambda: f320(short, out=out40), number),
+        ("getPoWHash", lambda: fpow(header), max(1, number // 200)),
+    ]
+    print("%-24s %12s" % ("call", "ns/call"))
+    for name, stmt, n in cases:
+        try:
+            print("%-24s %12.0f" % (name, best_ns(stmt, n)))
+        except TypeError:
+            # out= is not supported by older builds of the module
+            print("%-24s %12s" % (name, "n/a"))
+
+
+if __name__ == '__main__':
+    main()
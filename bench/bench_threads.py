@@ -0,0 +1,78 @@
+#!/usr/bin/env python
+# Copyright (c) 2014 Chilean Krypto-Miners.
+# Distributed under the MIT/X11 software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+"""Throughput of getPoWHash, getHash320 and getHash256 called from several
+Python threads at once. The module releases the GIL while hashing, so the
+hash rate should grow with the number of threads up to the number of cores.
+
+usage: bench_threads.py [max_threads] [seconds_per_run]
+"""
+
+from __future__ import print_function
+
+import os
+import struct
+import sys
+import threading
+import time
+
+import kshake320_hash
+
+try:
+    from os import cpu_count
+except ImportError:
+    from multiprocessing import cpu_count
+
+
+def _worker(func, data, deadline, counts, index):
+    n = 0
+    while time.time() < deadline:
+        for i in range(16):
+            func(data)
+        n += 16
+    counts[index] = n
+
+
+def run(func, data, threads, seconds):
+    counts = [0] * threads
+    deadline = time.time() + seconds
+    workers = [threading.Thread(target=_worker, args=(func, data, deadline, counts, i)) for i in range(threads)]
+    start = time.time()
+    for w in workers:
+        w.start()
+    for w in workers:
+        w.join()
+    return sum(counts) / (time.time() - start)
+
+
+def main():
+    max_threads = int(sys.argv[1]) if len(sys.argv) > 1 else (cpu_count() or 1)
+    seconds = float(sys.argv[2]) if len(sys.argv) > 2 else 2.0
+
+    header_v1 = struct.pack("<i", 1) + os.urandom(116)
+    header_v2 = struct.pack("<i", 2) + os.urandom(116)
+    message = os.urandom(4096)
+    cases = [
+        ("getPoWHash v1", kshake320_hash.getPoWHash, header_v1, "H/s"),
+        ("getPoWHash v2", kshake320_hash.getPoWHash, header_v2, "H/s"),
+        ("getHash320 4KiB", kshake320_hash.getHash320, message, "calls/s"),
+        ("getHash256 4KiB", kshake320_hash.getHash256, message, "calls/s"),
+    ]
+    thread_counts = sorted(set([1, 2, 4, 8, 16, 32, 64, max_threads]))
+    thread_counts = [t for t in thread_counts if t <= max_threads]
+
+    print("backend: %s, cpus: %s" % (kshake320_hash.getBackend(), cpu_count()))
+    for name, func, data, unit in cases:
+        print()
+        print("%-16s %8s %14s %8s" % (name, "threads", unit, "speedup"))
+        base = None
+        for threads in thread_counts:
+            rate = run(func, data, threads, seconds)
+            base = base or rate
+            print("%-16s %8d %14.0f %7.2fx" % ("", threads, rate, rate / base))
+
+
+if __name__ == '__main__':
+    main()
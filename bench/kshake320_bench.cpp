@@ -0,0 +1,429 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Benchmarks of libkshake320 layer by layer, from the Keccak-f[1600]
+// permutation up to the PoW, printed as one JSON document on stdout so that
+// the results of two commits can be compared by a script:
+//
+//   permute        cycles per permutation, for each backend the CPU supports
+//   fbwl_absorb    cycles per byte of the fast absorbing loop at rate 120
+//   fbwl_squeeze   cycles per byte of the fast squeezing loop at rate 120
+//   sha3_256       cycles per byte and MiB/s, from 32 B to 1 MiB
+//   shake320       likewise, with 40 bytes of output
+//   hash256        likewise, SHA3-256 applied twice
+//   pow_v1         hashes per second of KSHAKE320POW, per thread count
+//   pow_v2         likewise, with v2 headers
+//
+// Cycles are those of the time-stamp counter on x86, which may run at
+// another frequency than the core; the cycles_* fields are left out on other
+// CPUs. Each figure is the best of several samples, which makes it less
+// sensitive to other processes than a mean.
+//
+// usage: kshake320_bench [--time seconds] [--threads max] [--filter name] [--label text]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+// Without C linkage of their own, and included by pow.h through KeccakHash.h
+extern "C" {
+#include "keccak/KeccakF-1600/KeccakF-1600-interface.h"
+#include "keccak/SnP-interface.h"
+}
+#include "keccak/sha3.h"
+#include "kshake320/kshake320.h"
+#include "kshake320/pow.h"
+#ifdef USE_KECCAK_DISPATCH
+#include "keccak/KeccakF-1600/Dispatch/KeccakF-1600-dispatch.h"
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define KSHAKE320_BENCH_TSC
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options
+{
+    double seconds;
+    unsigned int threads;
+    std::string filter;
+    std::string label;
+};
+
+// Per call of the function measured.
+struct Sample
+{
+    double ns;
+    double cycles;
+};
+
+// Written with a byte of every output so that no computation is optimized out.
+volatile unsigned char sink;
+
+// A JSON string, escaped.
+void PrintString(const char *s)
+{
+    putchar('"');
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\')
+            printf("\\%c", *s);
+        else if ((unsigned char)*s < 0x20)
+            printf("\\u%04x", (unsigned char)*s);
+        else
+            putchar(*s);
+    }
+    putchar('"');
+}
+
+inline uint64_t Cycles()
+{
+#ifdef KSHAKE320_BENCH_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+double Seconds(Clock::duration d)
+{
+    return std::chrono::duration<double>(d).count();
+}
+
+// Calls f in runs long enough for the clock, for about the given time, and
+// keeps the fastest run.
+template<typename F>
+Sample Measure(F f, double seconds)
+{
+    uint64_t iterations = 1;
+    for (;;) {
+        Clock::time_point start = Clock::now();
+        for (uint64_t i = 0; i < iterations; i++)
+            f();
+        if (Seconds(Clock::now() - start) >= seconds / 20 || iterations >= (uint64_t(1) << 40))
+            break;
+        iterations *= 2;
+    }
+
+    Sample best = { 1e300, 1e300 };
+    Clock::time_point deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    do {
+        Clock::time_point start = Clock::now();
+        uint64_t c0 = Cycles();
+        for (uint64_t i = 0; i < iterations; i++)
+            f();
+        uint64_t c1 = Cycles();
+        double ns = Seconds(Clock::now() - start) * 1e9 / iterations;
+        if (ns < best.ns) {
+            best.ns = ns;
+            best.cycles = double(c1 - c0) / iterations;
+        }
+    } while (Clock::now() < deadline);
+    return best;
+}
+
+class Report
+{
+public:
+    explicit Report(const Options &options) : options(options), first(true) {}
+
+    bool Wanted(const char *name) const
+    {
+        return options.filter.empty() || strstr(name, options.filter.c_str()) != NULL;
+    }
+
+    // Starts the record of a benchmark; the fields follow with Field().
+    void Begin(const char *name)
+    {
+        printf("%s\n    {\"name\": ", first ? "" : ",");
+        PrintString(name);
+        first = false;
+    }
+
+    void Field(const char *key, const char *value) { printf(", \"%s\": ", key); PrintString(value); }
+    void Field(const char *key, uint64_t value) { printf(", \"%s\": %llu", key, (unsigned long long)value); }
+    void Field(const char *key, double value) { printf(", \"%s\": %.6g", key, value); }
+
+    void Cycles(const char *key, double value)
+    {
+#ifdef KSHAKE320_BENCH_TSC
+        Field(key, value);
+#endif
+    }
+
+    void End() { printf("}"); fflush(stdout); }
+
+    const Options &options;
+
+private:
+    bool first;
+};
+
+/* ---------------------------------------------------------------- */
+
+// The single-state functions of a backend.
+struct Backend
+{
+    const char *name;
+    void (*Permute)(void *state);
+    size_t (*FBWL_Absorb)(void *state, unsigned int laneCount, const unsigned char *data, size_t dataByteLen, unsigned char trailingBits);
+    size_t (*FBWL_Squeeze)(void *state, unsigned int laneCount, unsigned char *data, size_t dataByteLen);
+};
+
+std::vector<Backend> Backends()
+{
+    std::vector<Backend> backends;
+#ifdef USE_KECCAK_DISPATCH
+    static const char *const names[] = { "scalar", "avx2", "avx512" };
+    const KeccakF1600_Backend *active = KeccakF1600_ActiveBackend;
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (KeccakF1600_DispatchSelect(names[i]) != 0)
+            continue;
+        const KeccakF1600_Backend *b = KeccakF1600_ActiveBackend;
+        Backend backend = { b->name, b->Permute, b->FBWL_Absorb, b->FBWL_Squeeze };
+        backends.push_back(backend);
+    }
+    KeccakF1600_ActiveBackend = active;
+#else
+    // The default loops of SnP with Inplace32BI
+    Backend backend = { "scalar", SnP_Permute, SnP_FBWL_Absorb, SnP_FBWL_Squeeze };
+    backends.push_back(backend);
+#endif
+    return backends;
+}
+
+void BenchPermutation(Report &report)
+{
+    // 512 blocks of SHAKE320, the size of a PoW scratchpad
+    const unsigned int laneCount = KRATE / 8;
+    const size_t len = 512 * KRATE;
+    std::vector<unsigned char> data(len, 0x5A);
+    // Aligned for the AVX2 loads of the state
+    alignas(64) unsigned char state[KeccakF_stateSizeInBytes];
+
+    std::vector<Backend> backends = Backends();
+    for (size_t i = 0; i < backends.size(); i++) {
+        const Backend &b = backends[i];
+        KeccakF1600_StateInitialize(state);
+
+        if (report.Wanted("permute")) {
+            Sample s = Measure([&] { b.Permute(state); }, report.options.seconds);
+            report.Begin("permute");
+            report.Field("backend", b.name);
+            report.Cycles("cycles_per_permutation", s.cycles);
+            report.Field("ns_per_permutation", s.ns);
+            report.End();
+        }
+        if (report.Wanted("fbwl_absorb")) {
+            Sample s = Measure([&] { b.FBWL_Absorb(state, laneCount, data.data(), len, 0); }, report.options.seconds);
+            report.Begin("fbwl_absorb");
+            report.Field("backend", b.name);
+            report.Field("bytes", uint64_t(len));
+            report.Cycles("cycles_per_byte", s.cycles / len);
+            report.Field("mib_per_s", len / s.ns * 1e9 / 1048576);
+            report.End();
+        }
+        if (report.Wanted("fbwl_squeeze")) {
+            Sample s = Measure([&] { b.FBWL_Squeeze(state, laneCount, data.data(), len); }, report.options.seconds);
+            report.Begin("fbwl_squeeze");
+            report.Field("backend", b.name);
+            report.Field("bytes", uint64_t(len));
+            report.Cycles("cycles_per_byte", s.cycles / len);
+            report.Field("mib_per_s", len / s.ns * 1e9 / 1048576);
+            report.End();
+        }
+        sink = state[0];
+    }
+}
+
+/* ---------------------------------------------------------------- */
+
+void BenchMessage(Report &report, const char *name, void (*hash)(const unsigned char *data, size_t len, unsigned char *out))
+{
+    static const size_t sizes[] = { 32, 64, 128, 256, 1024, 4096, 16384, 65536, 262144, 1048576 };
+
+    if (!report.Wanted(name))
+        return;
+    std::vector<unsigned char> data(sizes[sizeof(sizes) / sizeof(sizes[0]) - 1]);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = (unsigned char)(i * 131 + 7);
+    unsigned char out[KSHAKE320_HASH_BYTES];
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        size_t len = sizes[i];
+        Sample s = Measure([&] { hash(data.data(), len, out); }, report.options.seconds);
+        sink = out[0];
+        report.Begin(name);
+        report.Field("backend", KSHAKE320Backend());
+        report.Field("bytes", uint64_t(len));
+        report.Cycles("cycles_per_byte", s.cycles / len);
+        report.Field("ns_per_call", s.ns);
+        report.Field("mib_per_s", len / s.ns * 1e9 / 1048576);
+        report.End();
+    }
+}
+
+void Sha3_256(const unsigned char *data, size_t len, unsigned char *out)
+{
+    SHA3_256(data, len, out);
+}
+
+void Shake320(const unsigned char *data, size_t len, unsigned char *out)
+{
+    SHAKE320(data, len * 8, out, KSHAKE320_HASH_BYTES);
+}
+
+void Hash256(const unsigned char *data, size_t len, unsigned char *out)
+{
+    GetHash256((const char *)data, len, (char *)out);
+}
+
+/* ---------------------------------------------------------------- */
+
+// KSHAKE320POW of headers of the given version on each thread, each with its
+// own scratchpad and nonces, for the given time.
+double PowRate(int version, unsigned int threads, double seconds)
+{
+    std::atomic<bool> stop(false);
+    std::vector<uint64_t> counts(threads, 0);
+    std::vector<std::thread> workers;
+
+    Clock::time_point start = Clock::now();
+    for (unsigned int t = 0; t < threads; t++) {
+        workers.push_back(std::thread([&, t] {
+            char header[KSHAKE320_HEADER_BYTES];
+            char hash[KSHAKE320_HASH_BYTES] = { 0 };
+            std::vector<unsigned char> scratchpad(KPROOF_OF_WORK_SZ);
+            for (size_t i = 0; i < sizeof(header); i++)
+                header[i] = (char)(i * 17 + t);
+            memcpy(header, &version, sizeof(version));
+            uint64_t n = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                KSHAKE320SetNonce(header, KSHAKE320_HEADER_BYTES - 4, uint32_t(n));
+                KSHAKE320POW(header, hash, scratchpad.data());
+                n++;
+            }
+            counts[t] = n;
+            sink = hash[0];
+        }));
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    for (size_t t = 0; t < workers.size(); t++)
+        workers[t].join();
+    double elapsed = Seconds(Clock::now() - start);
+
+    uint64_t total = 0;
+    for (size_t t = 0; t < counts.size(); t++)
+        total += counts[t];
+    return total / elapsed;
+}
+
+void BenchPow(Report &report)
+{
+    // 1, 2, 4... threads up to the maximum, which is always run
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int n = 1; n < report.options.threads; n *= 2)
+        threadCounts.push_back(n);
+    threadCounts.push_back(report.options.threads);
+
+    for (int version = 1; version <= 2; version++) {
+        const char *name = version == 1 ? "pow_v1" : "pow_v2";
+        if (!report.Wanted(name))
+            continue;
+        for (size_t i = 0; i < threadCounts.size(); i++) {
+            double rate = PowRate(version, threadCounts[i], report.options.seconds);
+            report.Begin(name);
+            report.Field("backend", KSHAKE320Backend());
+            report.Field("threads", uint64_t(threadCounts[i]));
+            report.Field("hashes_per_s", rate);
+            report.End();
+        }
+    }
+}
+
+/* ---------------------------------------------------------------- */
+
+const char *Compiler()
+{
+#if defined(__VERSION__)
+#if defined(__clang__)
+    return "clang " __VERSION__;
+#elif defined(__GNUC__)
+    return "gcc " __VERSION__;
+#else
+    return __VERSION__;
+#endif
+#elif defined(_MSC_VER)
+    return "msvc";
+#else
+    return "unknown";
+#endif
+}
+
+void Usage(const char *program)
+{
+    fprintf(stderr, "usage: %s [--time seconds] [--threads max] [--filter name] [--label text]\n", program);
+    exit(2);
+}
+
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    options.seconds = 0.5;
+    options.threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc)
+            Usage(argv[0]);
+        if (strcmp(argv[i], "--time") == 0)
+            options.seconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0)
+            options.threads = (unsigned int)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--filter") == 0)
+            options.filter = argv[++i];
+        else if (strcmp(argv[i], "--label") == 0)
+            options.label = argv[++i];
+        else
+            Usage(argv[0]);
+    }
+    if (options.seconds <= 0 || options.threads == 0)
+        Usage(argv[0]);
+
+    if (KSHAKE320Initialize() != 0)
+        fprintf(stderr, "%s: KSHAKE320_BACKEND or KSHAKE320_SHA256 ignored, using the detected implementations\n", argv[0]);
+
+    // The label, such as a commit, is only echoed
+    printf("{\n  \"version\": \"%s\",\n  \"label\": ", KSHAKE320_VERSION);
+    PrintString(options.label.c_str());
+    printf(",\n  \"compiler\": ");
+    PrintString(Compiler());
+    printf(",\n  \"backend\": \"%s\",\n  \"parallelism\": %u,\n  \"hardware_threads\": %u,\n  \"benchmarks\": [",
+        KSHAKE320Backend(), KSHAKE320Parallelism(), std::thread::hardware_concurrency());
+
+    Report report(options);
+    BenchPermutation(report);
+    BenchMessage(report, "sha3_256", Sha3_256);
+    BenchMessage(report, "shake320", Shake320);
+    BenchMessage(report, "hash256", Hash256);
+    BenchPow(report);
+
+    printf("\n  ]\n}\n");
+    return 0;
+}
@@ -0,0 +1,520 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Scaling of KSHAKE320POW with the number of threads, printed as CSV, one
+// row per run, to size machines from. The runs sweep:
+//
+//   threads      1, 2, 4... up to the maximum, which is always run
+//   pinning      none       left to the scheduler
+//                compact    thread i on the i-th allowed CPU, NUMA node
+//                           after NUMA node
+//                spread     the threads dealt round-robin to the nodes
+//                nodeN      all on the CPUs of node N, up to their number
+//                           (machines of several nodes only)
+//   scratchpad   of the v2 headers, v1 ones having none:
+//                stack      the 64 KiB array of KSHAKE320POW(input, output)
+//                arena      allocated by each thread once, on its own node
+//                           once pinned, and reused
+//                hugepage   likewise, in a 2 MiB huge page if the kernel has
+//                           one reserved (huge_pages=explicit), otherwise
+//                           in memory advised for transparent huge pages
+//                           (huge_pages=transparent), which the kernel may
+//                           or may not back with one
+//
+// Each row gives the hashes per second of all the threads, per thread and
+// of the slowest thread, and the efficiency: the rate per thread over that
+// of one thread with the same version, pinning and scratchpad, 1 for
+// perfect scaling, and the number of NUMA nodes of the pinned threads, 0
+// without pinning. A thread pins itself and allocates its scratchpad before
+// the clock starts. Pinning and the NUMA topology, read from sysfs, are only
+// known on Linux; the other systems run without pinning, and huge pages
+// need Linux too. The builds with KSHAKE320_V2_CHECKPOINT_INTERVAL keep no
+// scratchpad and report theirs as checkpoints.
+//
+// usage: kshake320_scaling [--time seconds] [--threads max] [--pinning list]
+//                          [--scratchpad list] [--label text]
+// with comma-separated lists, all of the above by default.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "kshake320/kshake320.h"
+#include "kshake320/pow.h"
+
+#ifdef __linux__
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+// As in pow.cpp, which keeps a scratchpad unless the build sets it
+#ifndef KSHAKE320_V2_CHECKPOINT_INTERVAL
+#define KSHAKE320_V2_CHECKPOINT_INTERVAL 0
+#endif
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options
+{
+    double seconds;
+    unsigned int threads;
+    std::vector<std::string> pinnings;
+    std::vector<std::string> scratchpads;
+    std::string label;
+};
+
+// Written with a byte of every output so that no computation is optimized out.
+volatile unsigned char sink;
+
+double Seconds(Clock::duration d)
+{
+    return std::chrono::duration<double>(d).count();
+}
+
+std::vector<std::string> Split(const std::string &list)
+{
+    std::vector<std::string> items;
+    size_t start = 0;
+    for (;;) {
+        size_t comma = list.find(',', start);
+        std::string item = list.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+        if (!item.empty())
+            items.push_back(item);
+        if (comma == std::string::npos)
+            return items;
+        start = comma + 1;
+    }
+}
+
+// Quoted, with the quotes doubled, if it has a comma, a quote or a newline.
+std::string CsvField(const std::string &s)
+{
+    if (s.find_first_of(",\"\n") == std::string::npos)
+        return s;
+    std::string quoted = "\"";
+    for (size_t i = 0; i < s.size(); i++) {
+        if (s[i] == '"')
+            quoted += '"';
+        quoted += s[i];
+    }
+    return quoted + "\"";
+}
+
+/* ---------------------------------------------------------------- */
+
+// The CPUs this process may run on, grouped by NUMA node, no node at all
+// where they are not known.
+struct Topology
+{
+    std::vector<std::vector<int> > nodes;
+    std::vector<int> nodeIds;
+};
+
+#ifdef __linux__
+// A cpulist of sysfs: "0-3,8,10-11"
+std::vector<int> ParseCpuList(const char *path)
+{
+    std::vector<int> cpus;
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+        return cpus;
+    char line[4096];
+    if (fgets(line, sizeof(line), f) != NULL) {
+        for (char *p = line; *p != 0 && *p != '\n'; ) {
+            char *end;
+            long first = strtol(p, &end, 10), last = first;
+            if (end == p)
+                break;
+            if (*end == '-')
+                last = strtol(end + 1, &end, 10);
+            for (long cpu = first; cpu <= last; cpu++)
+                cpus.push_back((int)cpu);
+            p = *end == ',' ? end + 1 : end;
+        }
+    }
+    fclose(f);
+    return cpus;
+}
+#endif
+
+Topology ReadTopology()
+{
+    Topology topology;
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        DIR *dir = opendir("/sys/devices/system/node");
+        std::vector<int> ids;
+        if (dir != NULL) {
+            struct dirent *entry;
+            while ((entry = readdir(dir)) != NULL) {
+                int id;
+                char extra;
+                if (sscanf(entry->d_name, "node%d%c", &id, &extra) == 1)
+                    ids.push_back(id);
+            }
+            closedir(dir);
+        }
+        std::sort(ids.begin(), ids.end());
+        std::vector<bool> seen(CPU_SETSIZE, false);
+        for (size_t i = 0; i < ids.size(); i++) {
+            char path[128];
+            snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", ids[i]);
+            std::vector<int> cpus, list = ParseCpuList(path);
+            for (size_t c = 0; c < list.size(); c++) {
+                if (list[c] < CPU_SETSIZE && CPU_ISSET(list[c], &allowed) && !seen[list[c]]) {
+                    cpus.push_back(list[c]);
+                    seen[list[c]] = true;
+                }
+            }
+            if (!cpus.empty()) {
+                topology.nodes.push_back(cpus);
+                topology.nodeIds.push_back(ids[i]);
+            }
+        }
+        // Without sysfs, or CPUs it does not list: a node of their own
+        std::vector<int> rest;
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &allowed) && !seen[cpu])
+                rest.push_back(cpu);
+        }
+        if (!rest.empty()) {
+            topology.nodes.push_back(rest);
+            topology.nodeIds.push_back(topology.nodes.size() == 1 ? 0 : -1);
+        }
+    }
+#endif
+    return topology;
+}
+
+// The CPU of each thread under a pinning, or an empty list for none.
+std::vector<int> PlaceThreads(const Topology &topology, const std::string &pinning, unsigned int threads)
+{
+    std::vector<int> cpus;
+    if (pinning == "compact") {
+        std::vector<int> all;
+        for (size_t n = 0; n < topology.nodes.size(); n++)
+            all.insert(all.end(), topology.nodes[n].begin(), topology.nodes[n].end());
+        for (unsigned int t = 0; t < threads; t++)
+            cpus.push_back(all[t % all.size()]);
+    }
+    else if (pinning == "spread") {
+        std::vector<size_t> next(topology.nodes.size(), 0);
+        for (unsigned int t = 0; t < threads; t++) {
+            size_t n = t % topology.nodes.size();
+            cpus.push_back(topology.nodes[n][next[n]++ % topology.nodes[n].size()]);
+        }
+    }
+    else if (pinning.compare(0, 4, "node") == 0) {
+        int id = atoi(pinning.c_str() + 4);
+        for (size_t n = 0; n < topology.nodes.size(); n++) {
+            if (topology.nodeIds[n] != id)
+                continue;
+            for (unsigned int t = 0; t < threads; t++)
+                cpus.push_back(topology.nodes[n][t % topology.nodes[n].size()]);
+        }
+    }
+    return cpus;
+}
+
+// The nodes the threads run on, 0 when not pinned.
+unsigned int CountNodes(const Topology &topology, const std::vector<int> &cpus)
+{
+    unsigned int count = 0;
+    for (size_t n = 0; n < topology.nodes.size(); n++) {
+        for (size_t i = 0; i < cpus.size(); i++) {
+            if (std::find(topology.nodes[n].begin(), topology.nodes[n].end(), cpus[i]) != topology.nodes[n].end()) {
+                count++;
+                break;
+            }
+        }
+    }
+    return count;
+}
+
+bool PinThread(int cpu)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+/* ---------------------------------------------------------------- */
+
+const size_t hugePageSize = 2 * 1024 * 1024;
+
+unsigned char *Align(void *p, size_t alignment)
+{
+    return (unsigned char *)(((uintptr_t)p + alignment - 1) & ~(uintptr_t)(alignment - 1));
+}
+
+// The scratchpad of one thread, allocated by the thread itself so that the
+// kernel places it on the node of the thread. A huge page that cannot be
+// had at all falls back to an arena, with huge_pages=none.
+class Scratchpad
+{
+public:
+    explicit Scratchpad(const std::string &kind) : data(NULL), hugePages(""), base(NULL), mappedSize(0)
+    {
+#ifdef __linux__
+        if (kind == "hugepage") {
+            hugePages = "none";
+            void *p = mmap(NULL, hugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p != MAP_FAILED) {
+                base = p;
+                mappedSize = hugePageSize;
+                data = (unsigned char *)p;
+                hugePages = "explicit";
+            }
+            else {
+                // Twice the size, for an aligned huge page within
+                p = mmap(NULL, 2 * hugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (p != MAP_FAILED) {
+                    base = p;
+                    mappedSize = 2 * hugePageSize;
+                    data = Align(p, hugePageSize);
+                    madvise(data, hugePageSize, MADV_HUGEPAGE);
+                    hugePages = "transparent";
+                }
+            }
+        }
+#endif
+        if (data == NULL && kind != "stack") {
+            arena.resize(KPROOF_OF_WORK_SZ + 63);
+            data = Align(arena.data(), 64);
+        }
+        // Touched now, not while timed
+        if (data != NULL)
+            memset(data, 0, KPROOF_OF_WORK_SZ);
+    }
+
+    ~Scratchpad()
+    {
+#ifdef __linux__
+        if (mappedSize != 0)
+            munmap(base, mappedSize);
+#endif
+    }
+
+    // NULL for the stack one
+    unsigned char *data;
+    const char *hugePages;
+
+private:
+    std::vector<unsigned char> arena;
+    void *base;
+    size_t mappedSize;
+};
+
+struct Result
+{
+    double hashesPerSecond;
+    double slowestThread;
+    std::string hugePages;
+};
+
+// Hashes headers of the given version on threads threads, placed on cpus
+// unless it is empty, each with a scratchpad of the given kind, for the
+// given time.
+Result Run(int version, const std::string &scratchpad, const std::vector<int> &cpus, unsigned int threads, double seconds)
+{
+    std::atomic<unsigned int> ready(0);
+    std::atomic<bool> go(false), stop(false);
+    std::vector<uint64_t> counts(threads, 0);
+    std::vector<std::string> hugePages(threads);
+    std::vector<std::thread> workers;
+
+    for (unsigned int t = 0; t < threads; t++) {
+        workers.push_back(std::thread([&, t] {
+            if (!cpus.empty())
+                PinThread(cpus[t]);
+            char header[KSHAKE320_HEADER_BYTES];
+            char hash[KSHAKE320_HASH_BYTES] = { 0 };
+            for (size_t i = 0; i < sizeof(header); i++)
+                header[i] = (char)(i * 17 + t);
+            memcpy(header, &version, sizeof(version));
+            Scratchpad pad(scratchpad);
+            hugePages[t] = pad.hugePages;
+
+            ready++;
+            while (!go.load(std::memory_order_acquire))
+                std::this_thread::yield();
+            uint64_t n = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                KSHAKE320SetNonce(header, KSHAKE320_HEADER_BYTES - 4, uint32_t(n));
+                if (pad.data != NULL)
+                    KSHAKE320POW(header, hash, pad.data);
+                else
+                    KSHAKE320POW(header, hash);
+                n++;
+            }
+            counts[t] = n;
+            sink = hash[0];
+        }));
+    }
+    while (ready.load() < threads)
+        std::this_thread::yield();
+    Clock::time_point start = Clock::now();
+    go.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    for (size_t t = 0; t < workers.size(); t++)
+        workers[t].join();
+    double elapsed = Seconds(Clock::now() - start);
+
+    Result result;
+    uint64_t total = 0, slowest = UINT64_MAX;
+    for (size_t t = 0; t < counts.size(); t++) {
+        total += counts[t];
+        slowest = std::min(slowest, counts[t]);
+    }
+    result.hashesPerSecond = total / elapsed;
+    result.slowestThread = slowest / elapsed;
+    result.hugePages = hugePages[0];
+    for (size_t t = 1; t < hugePages.size(); t++) {
+        if (hugePages[t] != hugePages[0])
+            result.hugePages = "mixed";
+    }
+    return result;
+}
+
+void Usage(const char *program)
+{
+    fprintf(stderr, "usage: %s [--time seconds] [--threads max] [--pinning none,compact,spread,nodeN...]\n"
+                    "       [--scratchpad stack,arena,hugepage] [--label text]\n", program);
+    exit(2);
+}
+
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    options.seconds = 1.0;
+    options.threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string pinnings, scratchpads = "stack,arena,hugepage";
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc)
+            Usage(argv[0]);
+        if (strcmp(argv[i], "--time") == 0)
+            options.seconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0)
+            options.threads = (unsigned int)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--pinning") == 0)
+            pinnings = argv[++i];
+        else if (strcmp(argv[i], "--scratchpad") == 0)
+            scratchpads = argv[++i];
+        else if (strcmp(argv[i], "--label") == 0)
+            options.label = argv[++i];
+        else
+            Usage(argv[0]);
+    }
+    if (options.seconds <= 0 || options.threads == 0)
+        Usage(argv[0]);
+
+    if (KSHAKE320Initialize() != 0)
+        fprintf(stderr, "%s: KSHAKE320_BACKEND or KSHAKE320_SHA256 ignored, using the detected implementations\n", argv[0]);
+
+    Topology topology = ReadTopology();
+    if (pinnings.empty()) {
+        pinnings = "none";
+        if (!topology.nodes.empty())
+            pinnings += ",compact,spread";
+        for (size_t n = 0; topology.nodes.size() > 1 && n < topology.nodes.size(); n++) {
+            if (topology.nodeIds[n] >= 0)
+                pinnings += ",node" + std::to_string(topology.nodeIds[n]);
+        }
+    }
+    options.pinnings = Split(pinnings);
+    options.scratchpads = Split(scratchpads);
+    for (size_t i = 0; i < options.pinnings.size(); i++) {
+        const std::string &p = options.pinnings[i];
+        if (p != "none" && topology.nodes.empty()) {
+            fprintf(stderr, "%s: pinning %s needs Linux\n", argv[0], p.c_str());
+            return 1;
+        }
+        if (p != "none" && PlaceThreads(topology, p, 1).empty()) {
+            fprintf(stderr, "%s: unknown pinning %s\n", argv[0], p.c_str());
+            return 1;
+        }
+    }
+    for (size_t i = 0; i < options.scratchpads.size(); i++) {
+        const std::string &s = options.scratchpads[i];
+#ifdef __linux__
+        const bool known = s == "stack" || s == "arena" || s == "hugepage";
+#else
+        const bool known = s == "stack" || s == "arena";
+#endif
+        if (!known) {
+            fprintf(stderr, "%s: unknown or unsupported scratchpad %s\n", argv[0], s.c_str());
+            return 1;
+        }
+    }
+
+    printf("label,backend,version,scratchpad,huge_pages,pinning,nodes,threads,"
+           "hashes_per_s,hashes_per_s_per_thread,slowest_thread_hashes_per_s,efficiency\n");
+    for (int version = 1; version <= 2; version++) {
+        std::vector<std::string> kinds;
+        if (version == 1)
+            kinds.push_back("none");
+        else if (KSHAKE320_V2_CHECKPOINT_INTERVAL > 0)
+            kinds.push_back("checkpoints");
+        else
+            kinds = options.scratchpads;
+
+        for (size_t k = 0; k < kinds.size(); k++) {
+            for (size_t p = 0; p < options.pinnings.size(); p++) {
+                const std::string &pinning = options.pinnings[p];
+                // A node has no more threads than CPUs
+                unsigned int maxThreads = options.threads;
+                if (pinning.compare(0, 4, "node") == 0) {
+                    int id = atoi(pinning.c_str() + 4);
+                    for (size_t n = 0; n < topology.nodes.size(); n++) {
+                        if (topology.nodeIds[n] == id)
+                            maxThreads = std::min(maxThreads, (unsigned int)topology.nodes[n].size());
+                    }
+                }
+                std::vector<unsigned int> threadCounts;
+                for (unsigned int n = 1; n < maxThreads; n *= 2)
+                    threadCounts.push_back(n);
+                threadCounts.push_back(maxThreads);
+
+                double single = 0;
+                for (size_t i = 0; i < threadCounts.size(); i++) {
+                    const unsigned int threads = threadCounts[i];
+                    std::vector<int> cpus = PlaceThreads(topology, pinning, threads);
+                    // v1 and the checkpoints take no scratchpad
+                    Result r = Run(version, version == 2 ? kinds[k] : "stack", cpus, threads, options.seconds);
+                    if (threads == 1)
+                        single = r.hashesPerSecond;
+                    printf("%s,%s,%d,%s,%s,%s,%u,%u,%.1f,%.1f,%.1f,%.3f\n",
+                        CsvField(options.label).c_str(), KSHAKE320Backend(), version, kinds[k].c_str(), r.hugePages.c_str(),
+                        pinning.c_str(), CountNodes(topology, cpus), threads, r.hashesPerSecond,
+                        r.hashesPerSecond / threads, r.slowestThread,
+                        single > 0 ? r.hashesPerSecond / threads / single : 0.0);
+                    fflush(stdout);
+                }
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+#!/usr/bin/env python
+# Copyright (c) 2014 Chilean Krypto-Miners.
+# Distributed under the MIT/X11 software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+"""Profile-guided build of the module and the library with CMake, and a
+report of its hash rates against the same build without a profile.
+
+The build directory gets two trees: plain/, built as usual, and pgo/, first
+built instrumented (KSHAKE320_PGO=generate), trained with pgo_train.py, then
+rebuilt with the profile (KSHAKE320_PGO=use). The rates of both come from
+pgo_train.py --bench.
+
+usage: pgo.py [build_dir] [seconds_per_case] [cmake options...]
+"""
+
+from __future__ import print_function
+
+import glob
+import os
+import subprocess
+import sys
+
+try:
+    from os import cpu_count
+except ImportError:
+    from multiprocessing import cpu_count
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SOURCE = os.path.dirname(HERE)
+
+
+def cmake(build, options):
+    subprocess.check_call(['cmake', '-S', SOURCE, '-B', build, '-DPython_EXECUTABLE=' + sys.executable] + options)
+    subprocess.check_call(['cmake', '--build', build, '-j', str(cpu_count() or 1)])
+
+
+def run_workload(build, args):
+    env = dict(os.environ, PYTHONPATH=os.path.join(build, 'python'))
+    output = subprocess.check_output([sys.executable, os.path.join(HERE, 'pgo_train.py')] + args, env=env)
+    return output.decode('ascii')
+
+
+def merge_clang_profile(profile_dir):
+    # Only Clang writes .profraw files, which it reads back merged
+    raw = glob.glob(os.path.join(profile_dir, '*.profraw'))
+    if raw:
+        subprocess.check_call(['llvm-profdata', 'merge', '-o', os.path.join(profile_dir, 'default.profdata')] + raw)
+
+
+def rates(report):
+    result = []
+    for line in report.splitlines():
+        name, rate, unit = line.split()
+        result.append((name, float(rate), unit))
+    return result
+
+
+def main():
+    build = os.path.abspath(sys.argv[1] if len(sys.argv) > 1 else 'build-pgo')
+    seconds = sys.argv[2] if len(sys.argv) > 2 else '2'
+    options = sys.argv[3:]
+    plain = os.path.join(build, 'plain')
+    pgo = os.path.join(build, 'pgo')
+    profile_dir = os.path.join(pgo, 'pgo-profile')
+
+    cmake(plain, options)
+
+    for stale in glob.glob(os.path.join(profile_dir, '*')):
+        os.remove(stale)
+    cmake(pgo, options + ['-DKSHAKE320_PGO=generate', '-DKSHAKE320_PGO_DIR=' + profile_dir])
+    run_workload(pgo, [])
+    merge_clang_profile(profile_dir)
+    cmake(pgo, options + ['-DKSHAKE320_PGO=use', '-DKSHAKE320_PGO_DIR=' + profile_dir])
+
+    before = rates(run_workload(plain, ['--bench', seconds]))
+    after = rates(run_workload(pgo, ['--bench', seconds]))
+    print()
+    print("%-14s %16s %16s %8s" % ("case", "plain", "pgo", "speedup"))
+    for (name, rate, unit), (_, pgo_rate, _) in zip(before, after):
+        print("%-14s %12.0f %-3s %12.0f %-3s %7.2fx" % (name, rate, unit, pgo_rate, unit, pgo_rate / rate))
+
+
+if __name__ == '__main__':
+    main()
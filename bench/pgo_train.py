@@ -0,0 +1,107 @@
+#!/usr/bin/env python
+# Copyright (c) 2014 Chilean Krypto-Miners.
+# Distributed under the MIT/X11 software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+"""Training workload of the profile-guided build (see pgo.py), in the
+proportions of a pool server: v1 and v2 PoW of single headers, batches and
+nonce scans, getHash256 of block-sized inputs and SHAKE320 used as an XOF.
+With --bench, times each part instead and prints its rate, one
+"name rate unit" line per part.
+
+usage: pgo_train.py [--bench [seconds_per_case]]
+"""
+
+from __future__ import print_function
+
+import os
+import struct
+import sys
+import time
+
+import kshake320_hash
+
+
+def _headers(count, version):
+    return [struct.pack("<i", version) + os.urandom(112) + struct.pack("<I", i) for i in range(count)]
+
+
+def cases():
+    headers_v1 = _headers(16, 1)
+    headers_v2 = _headers(16, 2)
+    mixed = b''.join(h for pair in zip(headers_v1, headers_v2) for h in pair)
+    job = kshake320_hash.PowJob(headers_v1[0])
+    # Headers, then blocks of a few transactions up to a full one
+    blocks = [os.urandom(n) for n in (80, 120, 1024, 16 * 1024, 256 * 1024)]
+    seed = os.urandom(64)
+
+    def pow_v1():
+        for h in headers_v1:
+            kshake320_hash.getPoWHash(h)
+        return len(headers_v1)
+
+    def pow_v2():
+        for h in headers_v2:
+            kshake320_hash.getPoWHash(h)
+        return len(headers_v2)
+
+    def pow_batch():
+        kshake320_hash.getPoWHashBatch(mixed, len(mixed) // 120)
+        return len(mixed) // 120
+
+    def pow_scan():
+        job.scan(0, 16, 0)
+        return 16
+
+    def hash256():
+        n = 0
+        for b in blocks:
+            kshake320_hash.getHash256(b)
+            n += len(b)
+        return n
+
+    def shake320_xof():
+        h = kshake320_hash.shake320(seed)
+        for i in range(16):
+            h.read(4096)
+        return 16 * 4096
+
+    # name, function, unit, weight in the training run
+    return [
+        ("pow_v1", pow_v1, "H/s", 4),
+        ("pow_v2", pow_v2, "H/s", 4),
+        ("pow_batch", pow_batch, "H/s", 2),
+        ("pow_scan", pow_scan, "H/s", 2),
+        ("hash256", hash256, "B/s", 2),
+        ("shake320_xof", shake320_xof, "B/s", 1),
+    ]
+
+
+def train(rounds=4):
+    for r in range(rounds):
+        for name, func, unit, weight in cases():
+            for i in range(weight):
+                func()
+
+
+def bench(seconds):
+    for name, func, unit, weight in cases():
+        func()
+        best = 0.0
+        deadline = time.time() + seconds
+        while time.time() < deadline:
+            start = time.time()
+            n = func()
+            best = max(best, n / max(time.time() - start, 1e-9))
+        print("%s %.0f %s" % (name, best, unit))
+
+
+def main():
+    if len(sys.argv) > 1 and sys.argv[1] == '--bench':
+        bench(float(sys.argv[2]) if len(sys.argv) > 2 else 1.0)
+    else:
+        train()
+
+
+if __name__ == '__main__':
+    main()
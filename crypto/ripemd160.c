@@ -0,0 +1,146 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <string.h>
+#include "ripemd160.h"
+#include "sha256.h"
+
+#define ROL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+// Message word and rotation of each round of the left and right lines
+static const unsigned char Ripemd160_RL[80] = {
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15,
+     7,  4, 13,  1, 10,  6, 15,  3, 12,  0,  9,  5,  2, 14, 11,  8,
+     3, 10, 14,  4,  9, 15,  8,  1,  2,  7,  0,  6, 13, 11,  5, 12,
+     1,  9, 11, 10,  0,  8, 12,  4, 13,  3,  7, 15, 14,  5,  6,  2,
+     4,  0,  5,  9,  7, 12,  2, 10, 14,  1,  3,  8, 11,  6, 15, 13,
+};
+static const unsigned char Ripemd160_RR[80] = {
+     5, 14,  7,  0,  9,  2, 11,  4, 13,  6, 15,  8,  1, 10,  3, 12,
+     6, 11,  3,  7,  0, 13,  5, 10, 14, 15,  8, 12,  4,  9,  1,  2,
+    15,  5,  1,  3,  7, 14,  6,  9, 11,  8, 12,  2, 10,  0,  4, 13,
+     8,  6,  4,  1,  3, 11, 15,  0,  5, 12,  2, 13,  9,  7, 10, 14,
+    12, 15, 10,  4,  1,  5,  8,  7,  6,  2, 13, 14,  0,  3,  9, 11,
+};
+static const unsigned char Ripemd160_SL[80] = {
+    11, 14, 15, 12,  5,  8,  7,  9, 11, 13, 14, 15,  6,  7,  9,  8,
+     7,  6,  8, 13, 11,  9,  7, 15,  7, 12, 15,  9, 11,  7, 13, 12,
+    11, 13,  6,  7, 14,  9, 13, 15, 14,  8, 13,  6,  5, 12,  7,  5,
+    11, 12, 14, 15, 14, 15,  9,  8,  9, 14,  5,  6,  8,  6,  5, 12,
+     9, 15,  5, 11,  6,  8, 13, 12,  5, 12, 13, 14, 11,  8,  5,  6,
+};
+static const unsigned char Ripemd160_SR[80] = {
+     8,  9,  9, 11, 13, 15, 15,  5,  7,  7,  8, 11, 14, 14, 12,  6,
+     9, 13, 15,  7, 12,  8,  9, 11,  7,  7, 12,  7,  6, 15, 13, 11,
+     9,  7, 15, 11,  8,  6,  6, 14, 12, 13,  5, 14, 13, 13,  7,  5,
+    15,  5,  8, 11, 14, 14,  6, 14,  6,  9, 12,  9, 12,  5, 15,  8,
+     8,  5, 12,  9, 12,  5, 14,  6,  8, 13,  6,  5, 15, 13, 11, 11,
+};
+static const uint32_t Ripemd160_KL[5] = { 0x00000000, 0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xA953FD4E };
+static const uint32_t Ripemd160_KR[5] = { 0x50A28BE6, 0x5C4DD124, 0x6D703EF3, 0x7A6D76E9, 0x00000000 };
+
+static uint32_t Ripemd160_F(unsigned int j, uint32_t x, uint32_t y, uint32_t z)
+{
+    switch (j) {
+    case 0: return x ^ y ^ z;
+    case 1: return (x & y) | (~x & z);
+    case 2: return (x | ~y) ^ z;
+    case 3: return (x & z) | (y & ~z);
+    default: return x ^ (y | ~z);
+    }
+}
+
+static void Ripemd160_Transform(uint32_t state[5], const unsigned char *block)
+{
+    uint32_t x[16];
+    uint32_t al = state[0], bl = state[1], cl = state[2], dl = state[3], el = state[4];
+    uint32_t ar = al, br = bl, cr = cl, dr = dl, er = el;
+    uint32_t t;
+    unsigned int i;
+
+    for(i=0; i<16; i++)
+        x[i] = (uint32_t)block[4*i] | ((uint32_t)block[4*i+1] << 8) | ((uint32_t)block[4*i+2] << 16) | ((uint32_t)block[4*i+3] << 24);
+
+    for(i=0; i<80; i++) {
+        unsigned int j = i / 16;
+        t = al + Ripemd160_F(j, bl, cl, dl) + x[Ripemd160_RL[i]] + Ripemd160_KL[j];
+        t = ROL32(t, Ripemd160_SL[i]) + el;
+        al = el; el = dl; dl = ROL32(cl, 10); cl = bl; bl = t;
+        // The right line runs the functions in reverse order
+        t = ar + Ripemd160_F(4 - j, br, cr, dr) + x[Ripemd160_RR[i]] + Ripemd160_KR[j];
+        t = ROL32(t, Ripemd160_SR[i]) + er;
+        ar = er; er = dr; dr = ROL32(cr, 10); cr = br; br = t;
+    }
+
+    t = state[1] + cl + dr;
+    state[1] = state[2] + dl + er;
+    state[2] = state[3] + el + ar;
+    state[3] = state[4] + al + br;
+    state[4] = state[0] + bl + cr;
+    state[0] = t;
+}
+
+void Ripemd160_Initialize(Ripemd160_Instance *instance)
+{
+    instance->state[0] = 0x67452301;
+    instance->state[1] = 0xEFCDAB89;
+    instance->state[2] = 0x98BADCFE;
+    instance->state[3] = 0x10325476;
+    instance->state[4] = 0xC3D2E1F0;
+    instance->byteCount = 0;
+}
+
+void Ripemd160_Update(Ripemd160_Instance *instance, const unsigned char *data, size_t dataByteLen)
+{
+    size_t used = (size_t)(instance->byteCount % 64);
+
+    instance->byteCount += dataByteLen;
+    if (used > 0) {
+        size_t partial = 64 - used;
+        if (dataByteLen < partial) {
+            memcpy(instance->buffer + used, data, dataByteLen);
+            return;
+        }
+        memcpy(instance->buffer + used, data, partial);
+        Ripemd160_Transform(instance->state, instance->buffer);
+        data += partial;
+        dataByteLen -= partial;
+    }
+    for( ; dataByteLen >= 64; data += 64, dataByteLen -= 64)
+        Ripemd160_Transform(instance->state, data);
+    memcpy(instance->buffer, data, dataByteLen);
+}
+
+void Ripemd160_Final(Ripemd160_Instance *instance, unsigned char *digest)
+{
+    static const unsigned char padding[64] = { 0x80 };
+    unsigned char length[8];
+    uint64_t bitCount = instance->byteCount * 8;
+    unsigned int i;
+
+    // Little-endian length, as the words
+    for(i=0; i<8; i++)
+        length[i] = (unsigned char)(bitCount >> (8*i));
+    Ripemd160_Update(instance, padding, 1 + ((119 - (size_t)(instance->byteCount % 64)) % 64));
+    Ripemd160_Update(instance, length, 8);
+    for(i=0; i<20; i++)
+        digest[i] = (unsigned char)(instance->state[i / 4] >> (8 * (i % 4)));
+}
+
+void Ripemd160(const unsigned char *data, size_t dataByteLen, unsigned char *digest)
+{
+    Ripemd160_Instance instance;
+
+    Ripemd160_Initialize(&instance);
+    Ripemd160_Update(&instance, data, dataByteLen);
+    Ripemd160_Final(&instance, digest);
+}
+
+void Hash160(const unsigned char *data, size_t dataByteLen, unsigned char *digest)
+{
+    unsigned char hash[Sha256_DigestLength];
+
+    Sha256(data, dataByteLen, hash);
+    Ripemd160(hash, sizeof(hash), digest);
+}
@@ -0,0 +1,39 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef _Ripemd160_h_
+#define _Ripemd160_h_
+
+// RIPEMD-160, for the Bitcoin-derived Hash160 of Kryptohash tooling.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define Ripemd160_DigestLength 20
+
+typedef struct {
+    uint32_t state[5];
+    unsigned char buffer[64];
+    uint64_t byteCount;
+} Ripemd160_Instance;
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+void Ripemd160_Initialize(Ripemd160_Instance *instance);
+void Ripemd160_Update(Ripemd160_Instance *instance, const unsigned char *data, size_t dataByteLen);
+void Ripemd160_Final(Ripemd160_Instance *instance, unsigned char *digest);
+
+/** RIPEMD-160 of dataByteLen bytes. */
+void Ripemd160(const unsigned char *data, size_t dataByteLen, unsigned char *digest);
+
+/** RIPEMD-160 of the SHA-256 of dataByteLen bytes, Bitcoin's Hash160(). */
+void Hash160(const unsigned char *data, size_t dataByteLen, unsigned char *digest);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif
@@ -0,0 +1,100 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// The SHA-256 compression function with the x86 SHA extensions, selected at
+// run time by sha256.c on the CPUs that have them along with SSE4.1.
+// The state is kept as the ABEF and CDGH halves SHA256RNDS2 works on.
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("sha,sse4.1,ssse3"))), apply_to=function)
+#elif defined(__GNUC__)
+#pragma GCC target("sha,sse4.1,ssse3")
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <immintrin.h>
+
+static const uint32_t Sha256_SHANI_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+// Four rounds on the message words w plus their constants
+#define Sha256_SHANI_Rounds(w, i) \
+    wk = _mm_add_epi32(w, _mm_loadu_si128((const __m128i *)&Sha256_SHANI_K[4*(i)])); \
+    cdgh = _mm_sha256rnds2_epu32(cdgh, abef, wk); \
+    abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(wk, 0x0E))
+
+// The next four message words in w0, from the last sixteen in w0 to w3:
+// w[t-16] + s0(w[t-15]) + w[t-7] + s1(w[t-2])
+#define Sha256_SHANI_Schedule(w0, w1, w2, w3) \
+    w0 = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(w0, w1), _mm_alignr_epi8(w3, w2, 4)), w3)
+
+void Sha256_TransformSHANI(uint32_t state[8], const unsigned char *blocks, size_t blockCount)
+{
+    // Big-endian words
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i abef, cdgh, tmp;
+
+    tmp = _mm_loadu_si128((const __m128i *)&state[0]);                  // DCBA
+    cdgh = _mm_loadu_si128((const __m128i *)&state[4]);                 // HGFE
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);                                 // CDAB
+    cdgh = _mm_shuffle_epi32(cdgh, 0x1B);                               // EFGH
+    abef = _mm_alignr_epi8(tmp, cdgh, 8);                               // ABEF
+    cdgh = _mm_blend_epi16(cdgh, tmp, 0xF0);                            // CDGH
+
+    for( ; blockCount > 0; blockCount--, blocks += 64) {
+        const __m128i abefSaved = abef, cdghSaved = cdgh;
+        __m128i w0, w1, w2, w3, wk;
+        unsigned int i;
+
+        w0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(blocks + 0)), byteSwap);
+        w1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(blocks + 16)), byteSwap);
+        w2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(blocks + 32)), byteSwap);
+        w3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(blocks + 48)), byteSwap);
+        Sha256_SHANI_Rounds(w0, 0);
+        Sha256_SHANI_Rounds(w1, 1);
+        Sha256_SHANI_Rounds(w2, 2);
+        Sha256_SHANI_Rounds(w3, 3);
+        for(i=4; i<16; i+=4) {
+            Sha256_SHANI_Schedule(w0, w1, w2, w3);
+            Sha256_SHANI_Rounds(w0, i);
+            Sha256_SHANI_Schedule(w1, w2, w3, w0);
+            Sha256_SHANI_Rounds(w1, i + 1);
+            Sha256_SHANI_Schedule(w2, w3, w0, w1);
+            Sha256_SHANI_Rounds(w2, i + 2);
+            Sha256_SHANI_Schedule(w3, w0, w1, w2);
+            Sha256_SHANI_Rounds(w3, i + 3);
+        }
+        abef = _mm_add_epi32(abef, abefSaved);
+        cdgh = _mm_add_epi32(cdgh, cdghSaved);
+    }
+
+    tmp = _mm_shuffle_epi32(abef, 0x1B);                                // FEBA
+    cdgh = _mm_shuffle_epi32(cdgh, 0xB1);                               // DCHG
+    abef = _mm_blend_epi16(tmp, cdgh, 0xF0);                            // DCBA
+    cdgh = _mm_alignr_epi8(cdgh, tmp, 8);                               // HGFE
+    _mm_storeu_si128((__m128i *)&state[0], abef);
+    _mm_storeu_si128((__m128i *)&state[4], cdgh);
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
+
+#else
+
+// ISO C forbids an empty translation unit
+typedef int Sha256_SHANI_Unused;
+
+#endif
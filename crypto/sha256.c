@@ -0,0 +1,219 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <stdlib.h>
+#include <string.h>
+#include "sha256.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define Sha256_DispatchX86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+// See sha256-shani.c
+void Sha256_TransformSHANI(uint32_t state[8], const unsigned char *blocks, size_t blockCount);
+#endif
+
+typedef void (*Sha256_Transform)(uint32_t state[8], const unsigned char *blocks, size_t blockCount);
+
+static const uint32_t Sha256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static uint32_t Sha256_LoadBE32(const unsigned char *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static void Sha256_StoreBE32(unsigned char *p, uint32_t x)
+{
+    p[0] = (unsigned char)(x >> 24);
+    p[1] = (unsigned char)(x >> 16);
+    p[2] = (unsigned char)(x >> 8);
+    p[3] = (unsigned char)x;
+}
+
+static void Sha256_TransformGeneric(uint32_t state[8], const unsigned char *blocks, size_t blockCount)
+{
+    uint32_t w[16];
+    unsigned int i;
+
+    for( ; blockCount > 0; blockCount--, blocks += 64) {
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+        for(i=0; i<64; i++) {
+            uint32_t t1, t2;
+            if (i < 16)
+                w[i] = Sha256_LoadBE32(blocks + 4*i);
+            else {
+                uint32_t w15 = w[(i - 15) & 15], w2 = w[(i - 2) & 15];
+                w[i & 15] += (ROR32(w15, 7) ^ ROR32(w15, 18) ^ (w15 >> 3))
+                    + w[(i - 7) & 15] + (ROR32(w2, 17) ^ ROR32(w2, 19) ^ (w2 >> 10));
+            }
+            t1 = h + (ROR32(e, 6) ^ ROR32(e, 11) ^ ROR32(e, 25)) + ((e & f) ^ (~e & g)) + Sha256_K[i] + w[i & 15];
+            t2 = (ROR32(a, 2) ^ ROR32(a, 13) ^ ROR32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+}
+
+/* ---------------------------------------------------------------- */
+
+typedef struct {
+    const char *name;
+    Sha256_Transform transform;
+} Sha256_Backend;
+
+// From the slowest to the fastest.
+static const Sha256_Backend Sha256_Backends[] = {
+    { "generic", Sha256_TransformGeneric },
+#ifdef Sha256_DispatchX86
+    { "shani", Sha256_TransformSHANI },
+#endif
+};
+
+#define Sha256_BackendCount (sizeof(Sha256_Backends)/sizeof(Sha256_Backends[0]))
+
+static const Sha256_Backend *Sha256_ActiveBackend = &Sha256_Backends[0];
+
+#ifdef Sha256_DispatchX86
+
+// Index in Sha256_Backends of the fastest compression function the CPU supports.
+static unsigned int Sha256_ProbeCPU(void)
+{
+    unsigned int regs[4] = { 0, 0, 0, 0 };
+    int hasSSE41, hasSHA;
+
+#if defined(_MSC_VER)
+    __cpuidex((int *)regs, 0, 0);
+    if (regs[0] < 7)
+        return 0;
+    __cpuidex((int *)regs, 1, 0);
+    // SSSE3 and SSE4.1
+    hasSSE41 = (regs[2] & ((1u << 9) | (1u << 19))) == ((1u << 9) | (1u << 19));
+    __cpuidex((int *)regs, 7, 0);
+#else
+    if (__get_cpuid_max(0, NULL) < 7)
+        return 0;
+    __get_cpuid(1, &regs[0], &regs[1], &regs[2], &regs[3]);
+    // SSSE3 and SSE4.1
+    hasSSE41 = (regs[2] & ((1u << 9) | (1u << 19))) == ((1u << 9) | (1u << 19));
+    __get_cpuid_count(7, 0, &regs[0], &regs[1], &regs[2], &regs[3]);
+#endif
+    hasSHA = (regs[1] & (1u << 29)) != 0;
+    return (hasSSE41 && hasSHA) ? 1 : 0;
+}
+
+#else
+
+static unsigned int Sha256_ProbeCPU(void)
+{
+    return 0;
+}
+
+#endif
+
+int Sha256_DispatchInitialize(void)
+{
+    const char *forced = getenv(Sha256_EnvironmentVariable);
+    unsigned int probed = Sha256_ProbeCPU();
+    unsigned int i;
+
+    Sha256_ActiveBackend = &Sha256_Backends[probed];
+    if ((forced == NULL) || (forced[0] == '\0'))
+        return 0;
+    for(i=0; i<=probed; i++)
+        if (strcmp(Sha256_Backends[i].name, forced) == 0) {
+            Sha256_ActiveBackend = &Sha256_Backends[i];
+            return 0;
+        }
+    return 1;
+}
+
+const char *Sha256_Implementation(void)
+{
+    return Sha256_ActiveBackend->name;
+}
+
+/* ---------------------------------------------------------------- */
+
+void Sha256_Initialize(Sha256_Instance *instance)
+{
+    static const uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    memcpy(instance->state, iv, sizeof(iv));
+    instance->byteCount = 0;
+}
+
+void Sha256_Update(Sha256_Instance *instance, const unsigned char *data, size_t dataByteLen)
+{
+    size_t used = (size_t)(instance->byteCount % 64);
+
+    instance->byteCount += dataByteLen;
+    if (used > 0) {
+        size_t partial = 64 - used;
+        if (dataByteLen < partial) {
+            memcpy(instance->buffer + used, data, dataByteLen);
+            return;
+        }
+        memcpy(instance->buffer + used, data, partial);
+        Sha256_ActiveBackend->transform(instance->state, instance->buffer, 1);
+        data += partial;
+        dataByteLen -= partial;
+    }
+    if (dataByteLen >= 64) {
+        Sha256_ActiveBackend->transform(instance->state, data, dataByteLen / 64);
+        data += dataByteLen & ~(size_t)63;
+        dataByteLen &= 63;
+    }
+    memcpy(instance->buffer, data, dataByteLen);
+}
+
+void Sha256_Final(Sha256_Instance *instance, unsigned char *digest)
+{
+    static const unsigned char padding[64] = { 0x80 };
+    unsigned char length[8];
+    uint64_t bitCount = instance->byteCount * 8;
+    unsigned int i;
+
+    Sha256_StoreBE32(length, (uint32_t)(bitCount >> 32));
+    Sha256_StoreBE32(length + 4, (uint32_t)bitCount);
+    Sha256_Update(instance, padding, 1 + ((119 - (size_t)(instance->byteCount % 64)) % 64));
+    Sha256_Update(instance, length, 8);
+    for(i=0; i<8; i++)
+        Sha256_StoreBE32(digest + 4*i, instance->state[i]);
+}
+
+void Sha256(const unsigned char *data, size_t dataByteLen, unsigned char *digest)
+{
+    Sha256_Instance instance;
+
+    Sha256_Initialize(&instance);
+    Sha256_Update(&instance, data, dataByteLen);
+    Sha256_Final(&instance, digest);
+}
+
+void Sha256d(const unsigned char *data, size_t dataByteLen, unsigned char *digest)
+{
+    unsigned char hash[Sha256_DigestLength];
+
+    Sha256(data, dataByteLen, hash);
+    Sha256(hash, sizeof(hash), digest);
+}
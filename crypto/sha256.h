@@ -0,0 +1,54 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef _Sha256_h_
+#define _Sha256_h_
+
+// SHA-256 (FIPS 180-4) for the Bitcoin-derived hashes of Kryptohash tooling.
+// The compression function uses the SHA extensions of x86-64 CPUs that have
+// them, once Sha256_DispatchInitialize() has been called.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define Sha256_DigestLength 32
+#define Sha256_EnvironmentVariable "KSHAKE320_SHA256"
+
+typedef struct {
+    uint32_t state[8];
+    unsigned char buffer[64];
+    uint64_t byteCount;
+} Sha256_Instance;
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+void Sha256_Initialize(Sha256_Instance *instance);
+void Sha256_Update(Sha256_Instance *instance, const unsigned char *data, size_t dataByteLen);
+void Sha256_Final(Sha256_Instance *instance, unsigned char *digest);
+
+/** SHA-256 of dataByteLen bytes. */
+void Sha256(const unsigned char *data, size_t dataByteLen, unsigned char *digest);
+
+/** SHA-256 of the SHA-256 of dataByteLen bytes, Bitcoin's Hash(). */
+void Sha256d(const unsigned char *data, size_t dataByteLen, unsigned char *digest);
+
+/**
+  * Function to probe the CPU and select the fastest compression function it
+  * supports. The choice can be forced by setting the environment variable
+  * KSHAKE320_SHA256 to the name of an implementation.
+  * @return Zero if successful, 1 if the forced implementation is unknown or
+  *         not supported by the CPU, in which case the probed one is used.
+  */
+int Sha256_DispatchInitialize(void);
+
+/** Name of the compression function in use: "generic" or "shani". */
+const char *Sha256_Implementation(void);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif
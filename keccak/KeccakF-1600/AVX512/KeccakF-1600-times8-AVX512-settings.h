@@ -0,0 +1 @@
+#define Unrolling 6
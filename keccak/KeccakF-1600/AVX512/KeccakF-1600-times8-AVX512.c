@@ -0,0 +1,209 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Keccak-f[1600] on eight interleaved states using 512-bit AVX-512 registers.
+// Rho uses VPROLQ and chi and the theta parities use VPTERNLOGQ.
+// The functions are compiled for AVX-512F whatever the global compiler flags,
+// so callers must check that the CPU supports AVX-512F before using them.
+
+#include <string.h>
+#include <immintrin.h>
+#include "KeccakF-1600-times8-AVX512-settings.h"
+#include "../KeccakF-1600-times8-interface.h"
+
+typedef unsigned char UINT8;
+typedef unsigned long long int UINT64;
+typedef __m512i V512;
+
+#if defined(__GNUC__)
+#define ALIGN __attribute__ ((aligned(64)))
+#define AVX512_FUNC __attribute__ ((target("avx512f")))
+#elif defined(_MSC_VER)
+#define ALIGN __declspec(align(64))
+#define AVX512_FUNC
+#else
+#define ALIGN
+#define AVX512_FUNC
+#endif
+
+// Marks the cases of the unrolled switches that go on to the next one.
+#if defined(__has_attribute)
+#if __has_attribute(fallthrough)
+#define FALLTHROUGH __attribute__ ((fallthrough))
+#endif
+#endif
+#ifndef FALLTHROUGH
+#define FALLTHROUGH
+#endif
+
+#define Chi512(a, b, c)         _mm512_ternarylogic_epi64(a, b, c, 0xD2)
+#define CONST512_64(a)          _mm512_set1_epi64(a)
+#define LOAD512(a)              _mm512_load_si512((const V512 *)&(a))
+#define ROL512(a, o)            _mm512_rol_epi64(a, o)
+#define STORE512(a, b)          _mm512_store_si512((V512 *)&(a), b)
+#define XOR3_512(a, b, c)       _mm512_ternarylogic_epi64(a, b, c, 0x96)
+#define XOR512(a, b)            _mm512_xor_si512(a, b)
+#define XOReq512(a, b)          a = _mm512_xor_si512(a, b)
+
+// Gather lane k of the eight instances into one register, and scatter it back.
+// instanceIndexes holds the byte offsets i * instanceStride of the instances.
+#define INDEXES8_64(stride) \
+    _mm512_set_epi64(7*(long long)(stride), 6*(long long)(stride), 5*(long long)(stride), 4*(long long)(stride), \
+                     3*(long long)(stride), 2*(long long)(stride), (long long)(stride), 0)
+#define LOAD8_64(input, instanceIndexes, k) \
+    _mm512_i64gather_epi64(instanceIndexes, (const void *)((input) + 8*(k)), 1)
+#define STORE8_64(output, instanceIndexes, k, v) \
+    { \
+        _mm512_i64scatter_epi64((void *)((output) + 8*(k)), instanceIndexes, v, 1); \
+    }
+
+static const UINT64 KeccakF1600times8RoundConstants[24] = {
+    0x0000000000000001ULL,
+    0x0000000000008082ULL,
+    0x800000000000808aULL,
+    0x8000000080008000ULL,
+    0x000000000000808bULL,
+    0x0000000080000001ULL,
+    0x8000000080008081ULL,
+    0x8000000000008009ULL,
+    0x000000000000008aULL,
+    0x0000000000000088ULL,
+    0x0000000080008009ULL,
+    0x000000008000000aULL,
+    0x000000008000808bULL,
+    0x800000000000008bULL,
+    0x8000000000008089ULL,
+    0x8000000000008003ULL,
+    0x8000000000008002ULL,
+    0x8000000000000080ULL,
+    0x000000000000800aULL,
+    0x800000008000000aULL,
+    0x8000000080008081ULL,
+    0x8000000000008080ULL,
+    0x0000000080000001ULL,
+    0x8000000080008008ULL };
+
+#include "KeccakF-1600-times8-AVX512.macros"
+#include "../Optimized64/KeccakF-1600-unrolling.macros"
+
+/* ---------------------------------------------------------------- */
+
+void KeccakF1600times8_StaticInitialize( void )
+{
+}
+
+/* ---------------------------------------------------------------- */
+
+void KeccakF1600times8_InitializeAll(void *states)
+{
+    memset(states, 0, KeccakF1600times8_statesSizeInBytes);
+}
+
+/* ---------------------------------------------------------------- */
+
+void KeccakF1600times8_XORBytes(void *states, unsigned int instanceIndex, const unsigned char *data, unsigned int offset, unsigned int length)
+{
+    unsigned int i;
+    UINT8 *statesAsBytes = (UINT8 *)states + instanceIndex*8;
+
+    for(i=0; i<length; i++, offset++)
+        statesAsBytes[(offset/8)*64 + (offset%8)] ^= data[i];
+}
+
+/* ---------------------------------------------------------------- */
+
+AVX512_FUNC void KeccakF1600times8_XORLanesAll(void *states, const unsigned char *data, unsigned int laneCount, size_t instanceStride)
+{
+    unsigned int i;
+    V512 *statesAsLanes = (V512 *)states;
+    V512 instanceIndexes = INDEXES8_64(instanceStride);
+
+    for(i=0; i<laneCount; i++)
+        STORE512(statesAsLanes[i], XOR512(LOAD512(statesAsLanes[i]), LOAD8_64(data, instanceIndexes, i)));
+}
+
+/* ---------------------------------------------------------------- */
+
+AVX512_FUNC void KeccakF1600times8_PermuteAll(void *states)
+{
+    declareABCDE
+    #ifndef FullUnrolling
+    unsigned int i;
+    #endif
+    V512 *statesAsLanes = (V512 *)states;
+
+    copyFromState(A, statesAsLanes)
+    rounds
+    copyToState(statesAsLanes, A)
+}
+
+/* ---------------------------------------------------------------- */
+
+void KeccakF1600times8_ExtractBytes(const void *states, unsigned int instanceIndex, unsigned char *data, unsigned int offset, unsigned int length)
+{
+    unsigned int i;
+    const UINT8 *statesAsBytes = (const UINT8 *)states + instanceIndex*8;
+
+    for(i=0; i<length; i++, offset++)
+        data[i] = statesAsBytes[(offset/8)*64 + (offset%8)];
+}
+
+/* ---------------------------------------------------------------- */
+
+AVX512_FUNC void KeccakF1600times8_ExtractLanesAll(const void *states, unsigned char *data, unsigned int laneCount, size_t instanceStride)
+{
+    unsigned int i;
+    const V512 *statesAsLanes = (const V512 *)states;
+    V512 instanceIndexes = INDEXES8_64(instanceStride);
+
+    for(i=0; i<laneCount; i++)
+        STORE8_64(data, instanceIndexes, i, LOAD512(statesAsLanes[i]))
+}
+
+/* ---------------------------------------------------------------- */
+
+AVX512_FUNC size_t KeccakF1600times8_FBWL_Absorb(void *states, unsigned int laneCount, const unsigned char *data, size_t instanceStride, size_t dataByteLen, unsigned char trailingBits)
+{
+    size_t originalDataByteLen = dataByteLen;
+    declareABCDE
+    #ifndef FullUnrolling
+    unsigned int i;
+    #endif
+    V512 *statesAsLanes = (V512 *)states;
+    V512 instanceIndexes = INDEXES8_64(instanceStride);
+    V512 trailingBitsAsLane = CONST512_64(trailingBits);
+
+    copyFromState(A, statesAsLanes)
+    while(dataByteLen >= laneCount*8) {
+        XORinputAndTrailingBits(A, data, instanceIndexes, laneCount, trailingBitsAsLane)
+        rounds
+        data += laneCount*8;
+        dataByteLen -= laneCount*8;
+    }
+    copyToState(statesAsLanes, A)
+    return originalDataByteLen - dataByteLen;
+}
+
+/* ---------------------------------------------------------------- */
+
+AVX512_FUNC size_t KeccakF1600times8_FBWL_Squeeze(void *states, unsigned int laneCount, unsigned char *data, size_t instanceStride, size_t dataByteLen)
+{
+    size_t originalDataByteLen = dataByteLen;
+    declareABCDE
+    #ifndef FullUnrolling
+    unsigned int i;
+    #endif
+    V512 *statesAsLanes = (V512 *)states;
+    V512 instanceIndexes = INDEXES8_64(instanceStride);
+
+    copyFromState(A, statesAsLanes)
+    while(dataByteLen >= laneCount*8) {
+        rounds
+        output(A, data, instanceIndexes, laneCount)
+        data += laneCount*8;
+        dataByteLen -= laneCount*8;
+    }
+    copyToState(statesAsLanes, A)
+    return originalDataByteLen - dataByteLen;
+}
@@ -0,0 +1,27 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef _PlSnP_Interface_h_
+#define _PlSnP_Interface_h_
+
+#include "../KeccakF-1600-times8-interface.h"
+
+#define PlSnP_parallelism                   KeccakF1600times8_parallelism
+#define PlSnP_statesSizeInBytes             KeccakF1600times8_statesSizeInBytes
+#define PlSnP_statesAlignment               KeccakF1600times8_statesAlignment
+#define PlSnP_laneLengthInBytes             8
+#define PlSnP_width                         1600
+
+#define PlSnP_StaticInitialize              KeccakF1600times8_StaticInitialize
+#define PlSnP_InitializeAll                 KeccakF1600times8_InitializeAll
+#define PlSnP_XORBytes                      KeccakF1600times8_XORBytes
+#define PlSnP_XORLanesAll                   KeccakF1600times8_XORLanesAll
+#define PlSnP_PermuteAll                    KeccakF1600times8_PermuteAll
+#define PlSnP_ExtractBytes                  KeccakF1600times8_ExtractBytes
+#define PlSnP_ExtractLanesAll               KeccakF1600times8_ExtractLanesAll
+
+#define PlSnP_FBWL_Absorb                   KeccakF1600times8_FBWL_Absorb
+#define PlSnP_FBWL_Squeeze                  KeccakF1600times8_FBWL_Squeeze
+
+#endif
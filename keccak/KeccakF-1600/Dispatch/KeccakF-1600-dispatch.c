@@ -0,0 +1,141 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <stdlib.h>
+#include <string.h>
+#include "KeccakF-1600-dispatch.h"
+#include "../KeccakF-1600-interface.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define KeccakF1600_DispatchX86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#ifdef KeccakF1600_DispatchX86
+// Optimized64 compiled for AVX2/BMI2, see ../Optimized64/KeccakF-1600-opt64-AVX2.c
+void KeccakF1600_AVX2_StatePermute(void *state);
+size_t KeccakF1600_AVX2_FBWL_Absorb(void *state, unsigned int laneCount, const unsigned char *data, size_t dataByteLen, unsigned char trailingBits);
+size_t KeccakF1600_AVX2_FBWL_Squeeze(void *state, unsigned int laneCount, unsigned char *data, size_t dataByteLen);
+size_t KeccakF1600_AVX2_FBWL_SqueezeAbsorb(void *squeezeState, void *absorbState, unsigned int laneCount, size_t dataByteLen);
+#endif
+
+// From the slowest to the fastest.
+// The single-state functions of the AVX-512 backend are those of the AVX2
+// one: only the parallel kernel takes advantage of the wider registers.
+static const KeccakF1600_Backend KeccakF1600_Backends[] = {
+    { "scalar", 1, KeccakF1600_StatePermute, KeccakF1600_FBWL_Absorb, KeccakF1600_FBWL_Squeeze, KeccakF1600_FBWL_SqueezeAbsorb },
+#ifdef KeccakF1600_DispatchX86
+    { "avx2", 4, KeccakF1600_AVX2_StatePermute, KeccakF1600_AVX2_FBWL_Absorb, KeccakF1600_AVX2_FBWL_Squeeze, KeccakF1600_AVX2_FBWL_SqueezeAbsorb },
+    { "avx512", 8, KeccakF1600_AVX2_StatePermute, KeccakF1600_AVX2_FBWL_Absorb, KeccakF1600_AVX2_FBWL_Squeeze, KeccakF1600_AVX2_FBWL_SqueezeAbsorb },
+#endif
+};
+
+#define KeccakF1600_BackendCount (sizeof(KeccakF1600_Backends)/sizeof(KeccakF1600_Backends[0]))
+
+const KeccakF1600_Backend *KeccakF1600_ActiveBackend = &KeccakF1600_Backends[0];
+
+/* ---------------------------------------------------------------- */
+
+#ifdef KeccakF1600_DispatchX86
+
+static void KeccakF1600_CPUID(unsigned int leaf, unsigned int subleaf, unsigned int regs[4])
+{
+#if defined(_MSC_VER)
+    __cpuidex((int *)regs, (int)leaf, (int)subleaf);
+#else
+    if (!__get_cpuid_count(leaf, subleaf, &regs[0], &regs[1], &regs[2], &regs[3]))
+        regs[0] = regs[1] = regs[2] = regs[3] = 0;
+#endif
+}
+
+static unsigned long long KeccakF1600_XGETBV(void)
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ __volatile__ ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+// Index in KeccakF1600_Backends of the fastest backend the CPU and the OS support.
+static unsigned int KeccakF1600_ProbeCPU(void)
+{
+    unsigned int regs[4];
+    unsigned long long xcr0;
+    int hasAVX2, hasAVX512;
+
+    KeccakF1600_CPUID(0, 0, regs);
+    if (regs[0] < 7)
+        return 0;
+    KeccakF1600_CPUID(1, 0, regs);
+    // OSXSAVE and AVX
+    if ((regs[2] & ((1u << 27) | (1u << 28))) != ((1u << 27) | (1u << 28)))
+        return 0;
+    xcr0 = KeccakF1600_XGETBV();
+    KeccakF1600_CPUID(7, 0, regs);
+    // XMM and YMM state enabled by the OS, AVX2, BMI1 and BMI2
+    hasAVX2 = ((xcr0 & 0x06) == 0x06)
+        && ((regs[1] & ((1u << 5) | (1u << 3) | (1u << 8))) == ((1u << 5) | (1u << 3) | (1u << 8)));
+    // Opmask and ZMM state enabled by the OS, AVX-512F
+    hasAVX512 = hasAVX2 && ((xcr0 & 0xE0) == 0xE0) && ((regs[1] & (1u << 16)) != 0);
+    return hasAVX512 ? 2 : (hasAVX2 ? 1 : 0);
+}
+
+#else
+
+static unsigned int KeccakF1600_ProbeCPU(void)
+{
+    return 0;
+}
+
+#endif
+
+/* ---------------------------------------------------------------- */
+
+static int KeccakF1600_FindBackend(const char *name)
+{
+    unsigned int i;
+
+    for(i=0; i<KeccakF1600_BackendCount; i++)
+        if (strcmp(KeccakF1600_Backends[i].name, name) == 0)
+            return (int)i;
+    return -1;
+}
+
+/* ---------------------------------------------------------------- */
+
+int KeccakF1600_DispatchIsSupported(const char *name)
+{
+    int index = KeccakF1600_FindBackend(name);
+
+    return (index >= 0) && ((unsigned int)index <= KeccakF1600_ProbeCPU());
+}
+
+/* ---------------------------------------------------------------- */
+
+int KeccakF1600_DispatchSelect(const char *name)
+{
+    if (!KeccakF1600_DispatchIsSupported(name))
+        return 1;
+    KeccakF1600_ActiveBackend = &KeccakF1600_Backends[KeccakF1600_FindBackend(name)];
+    return 0;
+}
+
+/* ---------------------------------------------------------------- */
+
+int KeccakF1600_DispatchInitialize(void)
+{
+    const char *forced = getenv(KeccakF1600_BackendEnvironmentVariable);
+
+    KeccakF1600_ActiveBackend = &KeccakF1600_Backends[KeccakF1600_ProbeCPU()];
+    if ((forced != NULL) && (forced[0] != '\0'))
+        return KeccakF1600_DispatchSelect(forced);
+    return 0;
+}
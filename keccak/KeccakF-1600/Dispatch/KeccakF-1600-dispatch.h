@@ -0,0 +1,59 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef _KeccakF1600Dispatch_h_
+#define _KeccakF1600Dispatch_h_
+
+#include <stddef.h>
+
+// Run-time selection of the Keccak-f[1600] implementation.
+// A backend bundles the single-state permutation and fast loops used by the
+// sponge, which all share the state layout of Optimized64, and tells how many
+// states its parallel kernel (KeccakSpongeTimes4/KeccakSpongeTimes8) handles.
+
+#define KeccakF1600_BackendEnvironmentVariable "KSHAKE320_BACKEND"
+
+typedef struct {
+    /** Name of the backend: "scalar", "avx2" or "avx512". */
+    const char *name;
+    /** Number of states processed by the parallel kernel, or 1 if there is none. */
+    unsigned int parallelism;
+    void (*Permute)(void *state);
+    size_t (*FBWL_Absorb)(void *state, unsigned int laneCount, const unsigned char *data, size_t dataByteLen, unsigned char trailingBits);
+    size_t (*FBWL_Squeeze)(void *state, unsigned int laneCount, unsigned char *data, size_t dataByteLen);
+    size_t (*FBWL_SqueezeAbsorb)(void *squeezeState, void *absorbState, unsigned int laneCount, size_t dataByteLen);
+} KeccakF1600_Backend;
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/** The backend in use, the scalar one until KeccakF1600_DispatchInitialize() is called. */
+extern const KeccakF1600_Backend *KeccakF1600_ActiveBackend;
+
+/**
+  * Function to probe the CPU and select the fastest backend it supports.
+  * The choice can be forced by setting the environment variable
+  * KSHAKE320_BACKEND to the name of a backend.
+  * @return Zero if successful, 1 if the forced backend is unknown or
+  *         not supported by the CPU, in which case the probed one is used.
+  */
+int KeccakF1600_DispatchInitialize(void);
+
+/**
+  * Function to select a backend by name.
+  * @return Zero if successful, 1 if the backend is unknown or not supported by the CPU.
+  */
+int KeccakF1600_DispatchSelect(const char *name);
+
+/**
+  * Function to tell whether a backend is compiled in and supported by the CPU.
+  */
+int KeccakF1600_DispatchIsSupported(const char *name);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif
@@ -0,0 +1,40 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef _SnP_Interface_h_
+#define _SnP_Interface_h_
+
+// Same as ../Optimized64/SnP-interface.h, except that the permutation and
+// the absorb/squeeze fast loops go through the backend selected at run time.
+
+#include "../KeccakF-1600-interface.h"
+#include "KeccakF-1600-dispatch.h"
+
+#define SnP_width                           KeccakF_width
+#define SnP_stateSizeInBytes                KeccakF_stateSizeInBytes
+#define SnP_laneLengthInBytes               KeccakF_laneInBytes
+
+#define SnP_StaticInitialize                KeccakF1600_Initialize
+#define SnP_Initialize                      KeccakF1600_StateInitialize
+#define SnP_XORBytesInLane                  KeccakF1600_StateXORBytesInLane
+#define SnP_XORLanes                        KeccakF1600_StateXORLanes
+#define SnP_OverwriteBytesInLane            KeccakF1600_StateOverwriteBytesInLane
+#define SnP_OverwriteLanes                  KeccakF1600_StateOverwriteLanes
+#define SnP_OverwriteWithZeroes             KeccakF1600_StateOverwriteWithZeroes
+#define SnP_ComplementBit                   KeccakF1600_StateComplementBit
+#define SnP_Permute                         (*KeccakF1600_ActiveBackend->Permute)
+#define SnP_ExtractBytesInLane              KeccakF1600_StateExtractBytesInLane
+#define SnP_ExtractLanes                    KeccakF1600_StateExtractLanes
+#define SnP_ExtractAndXORBytesInLane        KeccakF1600_StateExtractAndXORBytesInLane
+#define SnP_ExtractAndXORLanes              KeccakF1600_StateExtractAndXORLanes
+
+#include "../../SnP/SnP-Relaned.h"
+
+#define SnP_FBWL_Absorb                     (*KeccakF1600_ActiveBackend->FBWL_Absorb)
+#define SnP_FBWL_Squeeze                    (*KeccakF1600_ActiveBackend->FBWL_Squeeze)
+#define SnP_FBWL_SqueezeAbsorb              (*KeccakF1600_ActiveBackend->FBWL_SqueezeAbsorb)
+#define SnP_FBWL_Wrap                       KeccakF1600_FBWL_Wrap
+#define SnP_FBWL_Unwrap                     KeccakF1600_FBWL_Unwrap
+
+#endif
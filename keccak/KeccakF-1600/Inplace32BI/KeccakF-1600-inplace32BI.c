@@ -14,8 +14,8 @@ http://creativecommons.org/publicdomain/zero/1.0/
 */
 
 #include    <string.h>
-#include "brg_endian.h"
-#include "KeccakF-1600-interface.h"
+#include "../../brg_endian.h"
+#include "../KeccakF-1600-interface.h"
 
 typedef unsigned char UINT8;
 typedef unsigned int UINT32;
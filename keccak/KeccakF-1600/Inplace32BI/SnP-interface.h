@@ -42,6 +42,7 @@ http://creativecommons.org/publicdomain/zero/1.0/
 //TODO: improve this
 #define SnP_FBWL_Absorb                     SnP_FBWL_Absorb_Default
 #define SnP_FBWL_Squeeze                    SnP_FBWL_Squeeze_Default
+#define SnP_FBWL_SqueezeAbsorb              SnP_FBWL_SqueezeAbsorb_Default
 #define SnP_FBWL_Wrap                       SnP_FBWL_Wrap_Default
 #define SnP_FBWL_Unwrap                     SnP_FBWL_Unwrap_Default
 
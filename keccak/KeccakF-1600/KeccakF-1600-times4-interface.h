@@ -0,0 +1,37 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef _KeccakF1600times4Interface_h_
+#define _KeccakF1600times4Interface_h_
+
+#include <stddef.h>
+
+// Four independent Keccak-f[1600] states processed in lockstep.
+// The states are interleaved lane by lane: lane j of instance i is the
+// 64-bit word at index 4*j+i, so that each lane of the four instances
+// fits in a single 256-bit register.
+
+#define KeccakF1600times4_parallelism 4
+#define KeccakF1600times4_statesSizeInBytes (4*200)
+#define KeccakF1600times4_statesAlignment 32
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+void KeccakF1600times4_StaticInitialize( void );
+void KeccakF1600times4_InitializeAll(void *states);
+void KeccakF1600times4_XORBytes(void *states, unsigned int instanceIndex, const unsigned char *data, unsigned int offset, unsigned int length);
+void KeccakF1600times4_XORLanesAll(void *states, const unsigned char *data, unsigned int laneCount, size_t instanceStride);
+void KeccakF1600times4_PermuteAll(void *states);
+void KeccakF1600times4_ExtractBytes(const void *states, unsigned int instanceIndex, unsigned char *data, unsigned int offset, unsigned int length);
+void KeccakF1600times4_ExtractLanesAll(const void *states, unsigned char *data, unsigned int laneCount, size_t instanceStride);
+size_t KeccakF1600times4_FBWL_Absorb(void *states, unsigned int laneCount, const unsigned char *data, size_t instanceStride, size_t dataByteLen, unsigned char trailingBits);
+size_t KeccakF1600times4_FBWL_Squeeze(void *states, unsigned int laneCount, unsigned char *data, size_t instanceStride, size_t dataByteLen);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif
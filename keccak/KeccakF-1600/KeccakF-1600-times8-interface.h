@@ -0,0 +1,37 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef _KeccakF1600times8Interface_h_
+#define _KeccakF1600times8Interface_h_
+
+#include <stddef.h>
+
+// Eight independent Keccak-f[1600] states processed in lockstep.
+// The states are interleaved lane by lane: lane j of instance i is the
+// 64-bit word at index 8*j+i, so that each lane of the eight instances
+// fits in a single 512-bit register.
+
+#define KeccakF1600times8_parallelism 8
+#define KeccakF1600times8_statesSizeInBytes (8*200)
+#define KeccakF1600times8_statesAlignment 64
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+void KeccakF1600times8_StaticInitialize( void );
+void KeccakF1600times8_InitializeAll(void *states);
+void KeccakF1600times8_XORBytes(void *states, unsigned int instanceIndex, const unsigned char *data, unsigned int offset, unsigned int length);
+void KeccakF1600times8_XORLanesAll(void *states, const unsigned char *data, unsigned int laneCount, size_t instanceStride);
+void KeccakF1600times8_PermuteAll(void *states);
+void KeccakF1600times8_ExtractBytes(const void *states, unsigned int instanceIndex, unsigned char *data, unsigned int offset, unsigned int length);
+void KeccakF1600times8_ExtractLanesAll(const void *states, unsigned char *data, unsigned int laneCount, size_t instanceStride);
+size_t KeccakF1600times8_FBWL_Absorb(void *states, unsigned int laneCount, const unsigned char *data, size_t instanceStride, size_t dataByteLen, unsigned char trailingBits);
+size_t KeccakF1600times8_FBWL_Squeeze(void *states, unsigned int laneCount, unsigned char *data, size_t instanceStride, size_t dataByteLen);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif
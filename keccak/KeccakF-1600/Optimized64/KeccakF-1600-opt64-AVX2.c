@@ -0,0 +1,31 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// The Optimized64 permutation compiled for CPUs with AVX2, BMI1 and BMI2,
+// under the KeccakF1600_AVX2_ prefix so that it links next to the generic
+// build and can be selected at run time (see ../Dispatch).
+// Rotations are left to the compiler, which emits RORX instead of SHLD.
+// Only the functions bound by the dispatcher are compiled; the state
+// layout, lane complementing included, is the same as the generic build.
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2,bmi,bmi2"))), apply_to=function)
+#elif defined(__GNUC__)
+#pragma GCC target("avx2,bmi,bmi2")
+#endif
+
+#define KeccakF1600_Variant
+#define UseBMI2
+
+#define KeccakF1600RoundConstants           KeccakF1600_AVX2_RoundConstants
+#define KeccakF1600_StatePermute            KeccakF1600_AVX2_StatePermute
+#define KeccakF1600_FBWL_Absorb             KeccakF1600_AVX2_FBWL_Absorb
+#define KeccakF1600_FBWL_Squeeze            KeccakF1600_AVX2_FBWL_Squeeze
+#define KeccakF1600_FBWL_SqueezeAbsorb      KeccakF1600_AVX2_FBWL_SqueezeAbsorb
+
+#include "KeccakF-1600-opt64.c"
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
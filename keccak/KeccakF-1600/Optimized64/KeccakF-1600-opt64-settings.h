@@ -1,3 +1,5 @@
 #define FullUnrolling
 #define UseLaneComplementing
+#ifndef UseBMI2
 #define UseSHLD
+#endif
@@ -78,6 +78,8 @@ const UINT64 KeccakF1600RoundConstants[24] = {
 
 void KeccakF1600_StateXORPermuteExtract(void *state, const unsigned char *inData, unsigned int inLaneCount, unsigned char *outData, unsigned int outLaneCount);
 
+#ifndef KeccakF1600_Variant
+
 /* ---------------------------------------------------------------- */
 
 void KeccakF1600_Initialize( void )
@@ -259,6 +261,8 @@ void KeccakF1600_StateComplementBit(void *state, unsigned int position)
     ((UINT64*)state)[position/64] ^= lane;
 }
 
+#endif
+
 /* ---------------------------------------------------------------- */
 
 void KeccakF1600_StatePermute(void *state)
@@ -274,6 +278,8 @@ void KeccakF1600_StatePermute(void *state)
     copyToState(stateAsLanes, A)
 }
 
+#ifndef KeccakF1600_Variant
+
 /* ---------------------------------------------------------------- */
 
 void KeccakF1600_StateExtractBytesInLane(const void *state, unsigned int lanePosition, unsigned char *data, unsigned int offset, unsigned int length)
@@ -411,6 +417,8 @@ void KeccakF1600_StateExtractAndXORLanes(const void *state, unsigned char *data,
 #endif
 }
 
+#endif
+
 /* ---------------------------------------------------------------- */
 
 size_t KeccakF1600_FBWL_Absorb(void *state, unsigned int laneCount, const unsigned char *data, size_t dataByteLen, unsigned char trailingBits)
@@ -459,6 +467,46 @@ size_t KeccakF1600_FBWL_Squeeze(void *state, unsigned int laneCount, unsigned ch
 
 /* ---------------------------------------------------------------- */
 
+// The lanes of the squeezing state are XORed as stored into the absorbing
+// state, so the complemented ones must be complemented back afterwards.
+#ifdef UseLaneComplementing
+#define uncomplementInput(X, laneCount) \
+    if (laneCount > 1) X##be = ~X##be; \
+    if (laneCount > 2) X##bi = ~X##bi; \
+    if (laneCount > 8) X##go = ~X##go; \
+    if (laneCount > 12) X##ki = ~X##ki; \
+    if (laneCount > 17) X##me = ~X##me; \
+    if (laneCount > 20) X##sa = ~X##sa;
+#else
+#define uncomplementInput(X, laneCount)
+#endif
+
+size_t KeccakF1600_FBWL_SqueezeAbsorb(void *squeezeState, void *absorbState, unsigned int laneCount, size_t dataByteLen)
+{
+    size_t originalDataByteLen = dataByteLen;
+    declareABCDE
+    #ifndef FullUnrolling
+    unsigned int i;
+    #endif
+    UINT64 *squeezeStateAsLanes = (UINT64*)squeezeState;
+    UINT64 *absorbStateAsLanes = (UINT64*)absorbState;
+
+    copyFromState(A, absorbStateAsLanes)
+    while(dataByteLen >= laneCount*8) {
+        KeccakF1600_StatePermute(squeezeState);
+        XORinputAndTrailingBits(A, squeezeStateAsLanes, laneCount, 0)
+        uncomplementInput(A, laneCount)
+        rounds
+        dataByteLen -= laneCount*8;
+    }
+    copyToState(absorbStateAsLanes, A)
+    return originalDataByteLen - dataByteLen;
+}
+
+#ifndef KeccakF1600_Variant
+
+/* ---------------------------------------------------------------- */
+
 size_t KeccakF1600_FBWL_Wrap(void *state, unsigned int laneCount, const unsigned char *dataIn, unsigned char *dataOut, size_t dataByteLen, unsigned char trailingBits)
 {
     size_t originalDataByteLen = dataByteLen;
@@ -506,3 +554,5 @@ size_t KeccakF1600_FBWL_Unwrap(void *state, unsigned int laneCount, const unsign
     copyToState(stateAsLanes, A)
     return originalDataByteLen - dataByteLen;
 }
+
+#endif
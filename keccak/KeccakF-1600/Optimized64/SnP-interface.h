@@ -40,6 +40,7 @@ http://creativecommons.org/publicdomain/zero/1.0/
 
 #define SnP_FBWL_Absorb                     KeccakF1600_FBWL_Absorb
 #define SnP_FBWL_Squeeze                    KeccakF1600_FBWL_Squeeze
+#define SnP_FBWL_SqueezeAbsorb              KeccakF1600_FBWL_SqueezeAbsorb
 #define SnP_FBWL_Wrap                       KeccakF1600_FBWL_Wrap
 #define SnP_FBWL_Unwrap                     KeccakF1600_FBWL_Unwrap
 
@@ -0,0 +1,215 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Keccak-f[1600] on four interleaved states using 256-bit AVX2 registers.
+// The functions are compiled for AVX2 whatever the global compiler flags,
+// so callers must check that the CPU supports AVX2 before using them.
+
+#include <string.h>
+#include <immintrin.h>
+#include "KeccakF-1600-times4-SIMD256-settings.h"
+#include "../KeccakF-1600-times4-interface.h"
+
+typedef unsigned char UINT8;
+typedef unsigned long long int UINT64;
+typedef __m256i V256;
+
+#if defined(__GNUC__)
+#define ALIGN __attribute__ ((aligned(32)))
+#define SIMD256_FUNC __attribute__ ((target("avx2")))
+#elif defined(_MSC_VER)
+#define ALIGN __declspec(align(32))
+#define SIMD256_FUNC
+#else
+#define ALIGN
+#define SIMD256_FUNC
+#endif
+
+// Marks the cases of the unrolled switches that go on to the next one.
+#if defined(__has_attribute)
+#if __has_attribute(fallthrough)
+#define FALLTHROUGH __attribute__ ((fallthrough))
+#endif
+#endif
+#ifndef FALLTHROUGH
+#define FALLTHROUGH
+#endif
+
+#define ANDnu256(a, b)          _mm256_andnot_si256(a, b)
+#define CONST256(a)             _mm256_load_si256((const V256 *)&(a))
+#define CONST256_64(a)          _mm256_set1_epi64x(a)
+#define LOAD256(a)              _mm256_load_si256((const V256 *)&(a))
+#define ROL64in256(a, o)        _mm256_or_si256(_mm256_slli_epi64(a, o), _mm256_srli_epi64(a, 64-(o)))
+#define ROL64in256_8(a)         _mm256_shuffle_epi8(a, CONST256(rho8))
+#define ROL64in256_56(a)        _mm256_shuffle_epi8(a, CONST256(rho56))
+#define STORE256(a, b)          _mm256_store_si256((V256 *)&(a), b)
+#define XOR256(a, b)            _mm256_xor_si256(a, b)
+#define XOReq256(a, b)          a = _mm256_xor_si256(a, b)
+
+// Gather lane k of the four instances into one register, and scatter it back.
+#define LOAD4_64(input, stride, k) \
+    _mm256_inserti128_si256(_mm256_castsi128_si256( \
+        _mm_castpd_si128(_mm_loadh_pd(_mm_castsi128_pd(_mm_loadl_epi64((const __m128i *)((input) + 8*(k)))), (const double *)((input) + (stride) + 8*(k))))), \
+        _mm_castpd_si128(_mm_loadh_pd(_mm_castsi128_pd(_mm_loadl_epi64((const __m128i *)((input) + 2*(stride) + 8*(k)))), (const double *)((input) + 3*(stride) + 8*(k)))), 1)
+
+#define STORE4_64(output, stride, k, v) \
+    { \
+        __m128i _lo = _mm256_castsi256_si128(v); \
+        __m128i _hi = _mm256_extracti128_si256(v, 1); \
+        _mm_storel_epi64((__m128i *)((output) + 8*(k)), _lo); \
+        _mm_storeh_pd((double *)((output) + (stride) + 8*(k)), _mm_castsi128_pd(_lo)); \
+        _mm_storel_epi64((__m128i *)((output) + 2*(stride) + 8*(k)), _hi); \
+        _mm_storeh_pd((double *)((output) + 3*(stride) + 8*(k)), _mm_castsi128_pd(_hi)); \
+    }
+
+static const UINT64 ALIGN rho8[4] = {
+    0x0605040302010007ULL, 0x0E0D0C0B0A09080FULL, 0x0605040302010007ULL, 0x0E0D0C0B0A09080FULL };
+static const UINT64 ALIGN rho56[4] = {
+    0x0007060504030201ULL, 0x080F0E0D0C0B0A09ULL, 0x0007060504030201ULL, 0x080F0E0D0C0B0A09ULL };
+
+static const UINT64 KeccakF1600times4RoundConstants[24] = {
+    0x0000000000000001ULL,
+    0x0000000000008082ULL,
+    0x800000000000808aULL,
+    0x8000000080008000ULL,
+    0x000000000000808bULL,
+    0x0000000080000001ULL,
+    0x8000000080008081ULL,
+    0x8000000000008009ULL,
+    0x000000000000008aULL,
+    0x0000000000000088ULL,
+    0x0000000080008009ULL,
+    0x000000008000000aULL,
+    0x000000008000808bULL,
+    0x800000000000008bULL,
+    0x8000000000008089ULL,
+    0x8000000000008003ULL,
+    0x8000000000008002ULL,
+    0x8000000000000080ULL,
+    0x000000000000800aULL,
+    0x800000008000000aULL,
+    0x8000000080008081ULL,
+    0x8000000000008080ULL,
+    0x0000000080000001ULL,
+    0x8000000080008008ULL };
+
+#include "KeccakF-1600-times4-SIMD256.macros"
+#include "../Optimized64/KeccakF-1600-unrolling.macros"
+
+/* ---------------------------------------------------------------- */
+
+void KeccakF1600times4_StaticInitialize( void )
+{
+}
+
+/* ---------------------------------------------------------------- */
+
+void KeccakF1600times4_InitializeAll(void *states)
+{
+    memset(states, 0, KeccakF1600times4_statesSizeInBytes);
+}
+
+/* ---------------------------------------------------------------- */
+
+void KeccakF1600times4_XORBytes(void *states, unsigned int instanceIndex, const unsigned char *data, unsigned int offset, unsigned int length)
+{
+    unsigned int i;
+    UINT8 *statesAsBytes = (UINT8 *)states + instanceIndex*8;
+
+    for(i=0; i<length; i++, offset++)
+        statesAsBytes[(offset/8)*32 + (offset%8)] ^= data[i];
+}
+
+/* ---------------------------------------------------------------- */
+
+SIMD256_FUNC void KeccakF1600times4_XORLanesAll(void *states, const unsigned char *data, unsigned int laneCount, size_t instanceStride)
+{
+    unsigned int i;
+    V256 *statesAsLanes = (V256 *)states;
+
+    for(i=0; i<laneCount; i++)
+        STORE256(statesAsLanes[i], XOR256(LOAD256(statesAsLanes[i]), LOAD4_64(data, instanceStride, i)));
+}
+
+/* ---------------------------------------------------------------- */
+
+SIMD256_FUNC void KeccakF1600times4_PermuteAll(void *states)
+{
+    declareABCDE
+    #ifndef FullUnrolling
+    unsigned int i;
+    #endif
+    V256 *statesAsLanes = (V256 *)states;
+
+    copyFromState(A, statesAsLanes)
+    rounds
+    copyToState(statesAsLanes, A)
+}
+
+/* ---------------------------------------------------------------- */
+
+void KeccakF1600times4_ExtractBytes(const void *states, unsigned int instanceIndex, unsigned char *data, unsigned int offset, unsigned int length)
+{
+    unsigned int i;
+    const UINT8 *statesAsBytes = (const UINT8 *)states + instanceIndex*8;
+
+    for(i=0; i<length; i++, offset++)
+        data[i] = statesAsBytes[(offset/8)*32 + (offset%8)];
+}
+
+/* ---------------------------------------------------------------- */
+
+SIMD256_FUNC void KeccakF1600times4_ExtractLanesAll(const void *states, unsigned char *data, unsigned int laneCount, size_t instanceStride)
+{
+    unsigned int i;
+    const V256 *statesAsLanes = (const V256 *)states;
+
+    for(i=0; i<laneCount; i++)
+        STORE4_64(data, instanceStride, i, LOAD256(statesAsLanes[i]))
+}
+
+/* ---------------------------------------------------------------- */
+
+SIMD256_FUNC size_t KeccakF1600times4_FBWL_Absorb(void *states, unsigned int laneCount, const unsigned char *data, size_t instanceStride, size_t dataByteLen, unsigned char trailingBits)
+{
+    size_t originalDataByteLen = dataByteLen;
+    declareABCDE
+    #ifndef FullUnrolling
+    unsigned int i;
+    #endif
+    V256 *statesAsLanes = (V256 *)states;
+    V256 trailingBitsAsLane = CONST256_64(trailingBits);
+
+    copyFromState(A, statesAsLanes)
+    while(dataByteLen >= laneCount*8) {
+        XORinputAndTrailingBits(A, data, instanceStride, laneCount, trailingBitsAsLane)
+        rounds
+        data += laneCount*8;
+        dataByteLen -= laneCount*8;
+    }
+    copyToState(statesAsLanes, A)
+    return originalDataByteLen - dataByteLen;
+}
+
+/* ---------------------------------------------------------------- */
+
+SIMD256_FUNC size_t KeccakF1600times4_FBWL_Squeeze(void *states, unsigned int laneCount, unsigned char *data, size_t instanceStride, size_t dataByteLen)
+{
+    size_t originalDataByteLen = dataByteLen;
+    declareABCDE
+    #ifndef FullUnrolling
+    unsigned int i;
+    #endif
+    V256 *statesAsLanes = (V256 *)states;
+
+    copyFromState(A, statesAsLanes)
+    while(dataByteLen >= laneCount*8) {
+        rounds
+        output(A, data, instanceStride, laneCount)
+        data += laneCount*8;
+        dataByteLen -= laneCount*8;
+    }
+    copyToState(statesAsLanes, A)
+    return originalDataByteLen - dataByteLen;
+}
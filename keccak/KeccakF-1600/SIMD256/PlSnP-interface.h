@@ -0,0 +1,27 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef _PlSnP_Interface_h_
+#define _PlSnP_Interface_h_
+
+#include "../KeccakF-1600-times4-interface.h"
+
+#define PlSnP_parallelism                   KeccakF1600times4_parallelism
+#define PlSnP_statesSizeInBytes             KeccakF1600times4_statesSizeInBytes
+#define PlSnP_statesAlignment               KeccakF1600times4_statesAlignment
+#define PlSnP_laneLengthInBytes             8
+#define PlSnP_width                         1600
+
+#define PlSnP_StaticInitialize              KeccakF1600times4_StaticInitialize
+#define PlSnP_InitializeAll                 KeccakF1600times4_InitializeAll
+#define PlSnP_XORBytes                      KeccakF1600times4_XORBytes
+#define PlSnP_XORLanesAll                   KeccakF1600times4_XORLanesAll
+#define PlSnP_PermuteAll                    KeccakF1600times4_PermuteAll
+#define PlSnP_ExtractBytes                  KeccakF1600times4_ExtractBytes
+#define PlSnP_ExtractLanesAll               KeccakF1600times4_ExtractLanesAll
+
+#define PlSnP_FBWL_Absorb                   KeccakF1600times4_FBWL_Absorb
+#define PlSnP_FBWL_Squeeze                  KeccakF1600times4_FBWL_Squeeze
+
+#endif
@@ -190,3 +190,45 @@ int Keccak_SpongeSqueeze(Keccak_SpongeInstance *instance, unsigned char *data, s
     }
     return 0;
 }
+
+/* ---------------------------------------------------------------- */
+
+int Keccak_SpongeSqueezeIntoAbsorb(Keccak_SpongeInstance *squeezeInstance, Keccak_SpongeInstance *absorbInstance, size_t dataByteLen)
+{
+    size_t i, j;
+    unsigned int partialBlock;
+    unsigned int rateInBytes = squeezeInstance->rate/8;
+    unsigned char block[SnP_width/8];
+
+    if (absorbInstance->rate != squeezeInstance->rate)
+        return 1;
+    if (absorbInstance->squeezing)
+        return 1; // Too late for additional input
+    if (!squeezeInstance->squeezing)
+        Keccak_SpongeAbsorbLastFewBits(squeezeInstance, 0x01);
+
+    i = 0;
+    while(i < dataByteLen) {
+        if ((squeezeInstance->byteIOIndex == rateInBytes) && (absorbInstance->byteIOIndex == 0)
+            && (dataByteLen >= (i + rateInBytes)) && ((rateInBytes % SnP_laneLengthInBytes) == 0)) {
+            // fast lane: whole blocks from state to state
+            j = SnP_FBWL_SqueezeAbsorb(squeezeInstance->state, absorbInstance->state, rateInBytes/SnP_laneLengthInBytes, dataByteLen - i);
+            i += j;
+        }
+        else {
+            // normal lane: through a block buffer, up to the next block boundary of either instance
+            partialBlock = (unsigned int)(dataByteLen - i);
+            if (partialBlock > rateInBytes)
+                partialBlock = rateInBytes;
+            if ((squeezeInstance->byteIOIndex < rateInBytes) && (partialBlock+squeezeInstance->byteIOIndex > rateInBytes))
+                partialBlock = rateInBytes-squeezeInstance->byteIOIndex;
+            if (partialBlock+absorbInstance->byteIOIndex > rateInBytes)
+                partialBlock = rateInBytes-absorbInstance->byteIOIndex;
+            i += partialBlock;
+
+            Keccak_SpongeSqueeze(squeezeInstance, block, partialBlock);
+            Keccak_SpongeAbsorb(absorbInstance, block, partialBlock);
+        }
+    }
+    return 0;
+}
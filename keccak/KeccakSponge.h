@@ -50,6 +50,10 @@ ALIGN typedef struct Keccak_SpongeInstanceStruct {
     int squeezing;
 } Keccak_SpongeInstance;
 
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
 /**
   * Function to initialize the state of the Keccak[r, c] sponge function.
   * The phase of the sponge function is set to absorbing.
@@ -110,4 +114,22 @@ int Keccak_SpongeAbsorbLastFewBits(Keccak_SpongeInstance *spongeInstance, unsign
   */
 int Keccak_SpongeSqueeze(Keccak_SpongeInstance *spongeInstance, unsigned char *data, size_t dataByteLen);
 
+/**
+  * Function to squeeze output data from one sponge function and to give it
+  * to another one to absorb, as Keccak_SpongeSqueeze() followed by
+  * Keccak_SpongeAbsorb() would do, but without storing the whole output.
+  * Full blocks go directly from one state to the other.
+  * @param  squeezeInstance Pointer to the sponge instance to squeeze from.
+  * @param  absorbInstance  Pointer to the sponge instance to absorb into.
+  * @param  dataByteLen The number of bytes to transfer.
+  * @pre    Both instances must have the same rate.
+  * @pre    The sponge function @a absorbInstance must be in the absorbing phase.
+  * @return Zero if successful, 1 otherwise.
+  */
+int Keccak_SpongeSqueezeIntoAbsorb(Keccak_SpongeInstance *squeezeInstance, Keccak_SpongeInstance *absorbInstance, size_t dataByteLen);
+
+#if defined (__cplusplus)
+}
+#endif
+
 #endif
@@ -0,0 +1,11 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <string.h>
+#include "KeccakSpongeTimes4.h"
+#include "KeccakF-1600/SIMD256/PlSnP-interface.h"
+
+#define prefix KeccakTimes4
+#include "KeccakParallelSponge.inc"
+#undef prefix
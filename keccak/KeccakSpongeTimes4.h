@@ -0,0 +1,80 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef _KeccakSpongeTimes4_h_
+#define _KeccakSpongeTimes4_h_
+
+#include <string.h>
+#include "KeccakF-1600/KeccakF-1600-times4-interface.h"
+
+#if defined(__GNUC__)
+#define ALIGN_TIMES4 __attribute__ ((aligned(KeccakF1600times4_statesAlignment)))
+#elif defined(_MSC_VER)
+#define ALIGN_TIMES4 __declspec(align(32))
+#else
+#define ALIGN_TIMES4
+#endif
+
+/**
+  * Structure that contains four sponge instances processed in lockstep
+  * for use with the KeccakTimes4_Sponge* functions.
+  * The four instances share the rate, the position of input/output bytes
+  * in the state and the phase (absorbing or squeezing).
+  */
+ALIGN_TIMES4 typedef struct KeccakTimes4_SpongeInstanceStruct {
+    /** The four interleaved states processed by the permutation. */
+    ALIGN_TIMES4 unsigned char states[KeccakF1600times4_statesSizeInBytes];
+    /** The value of the rate in bits.*/
+    unsigned int rate;
+    /** The position in the states of the next byte to be input (when absorbing) or output (when squeezing). */
+    unsigned int byteIOIndex;
+    /** If set to 0, in the absorbing phase; otherwise, in the squeezing phase. */
+    int squeezing;
+} KeccakTimes4_SpongeInstance;
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/**
+  * Function to initialize four Keccak[r, c] sponge functions.
+  * @pre    The CPU supports AVX2.
+  * @return Zero if successful, 1 otherwise.
+  * @see    Keccak_SpongeInitialize()
+  */
+int KeccakTimes4_SpongeInitialize(KeccakTimes4_SpongeInstance *spongeInstance, unsigned int rate, unsigned int capacity);
+
+/**
+  * Function to give the same number of input bytes to each of the four sponges.
+  * @param  data            Pointer to the input data of the first instance.
+  * @param  instanceStride  Distance in bytes between the input data of two consecutive instances.
+  * @param  dataByteLen     The number of input bytes provided to each instance.
+  * @return Zero if successful, 1 otherwise.
+  * @see    Keccak_SpongeAbsorb()
+  */
+int KeccakTimes4_SpongeAbsorb(KeccakTimes4_SpongeInstance *spongeInstance, const unsigned char *data, size_t instanceStride, size_t dataByteLen);
+
+/**
+  * Function to absorb the same trailing bits into the four sponges
+  * and then to switch to the squeezing phase.
+  * @return Zero if successful, 1 otherwise.
+  * @see    Keccak_SpongeAbsorbLastFewBits()
+  */
+int KeccakTimes4_SpongeAbsorbLastFewBits(KeccakTimes4_SpongeInstance *spongeInstance, unsigned char delimitedData);
+
+/**
+  * Function to squeeze the same number of output bytes from each of the four sponges.
+  * @param  data            Pointer to the output area of the first instance.
+  * @param  instanceStride  Distance in bytes between the output areas of two consecutive instances.
+  * @param  dataByteLen     The number of output bytes desired from each instance.
+  * @return Zero if successful, 1 otherwise.
+  * @see    Keccak_SpongeSqueeze()
+  */
+int KeccakTimes4_SpongeSqueeze(KeccakTimes4_SpongeInstance *spongeInstance, unsigned char *data, size_t instanceStride, size_t dataByteLen);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif
@@ -0,0 +1,11 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <string.h>
+#include "KeccakSpongeTimes8.h"
+#include "KeccakF-1600/AVX512/PlSnP-interface.h"
+
+#define prefix KeccakTimes8
+#include "KeccakParallelSponge.inc"
+#undef prefix
@@ -0,0 +1,80 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef _KeccakSpongeTimes8_h_
+#define _KeccakSpongeTimes8_h_
+
+#include <string.h>
+#include "KeccakF-1600/KeccakF-1600-times8-interface.h"
+
+#if defined(__GNUC__)
+#define ALIGN_TIMES8 __attribute__ ((aligned(KeccakF1600times8_statesAlignment)))
+#elif defined(_MSC_VER)
+#define ALIGN_TIMES8 __declspec(align(64))
+#else
+#define ALIGN_TIMES8
+#endif
+
+/**
+  * Structure that contains eight sponge instances processed in lockstep
+  * for use with the KeccakTimes8_Sponge* functions.
+  * The eight instances share the rate, the position of input/output bytes
+  * in the state and the phase (absorbing or squeezing).
+  */
+ALIGN_TIMES8 typedef struct KeccakTimes8_SpongeInstanceStruct {
+    /** The eight interleaved states processed by the permutation. */
+    ALIGN_TIMES8 unsigned char states[KeccakF1600times8_statesSizeInBytes];
+    /** The value of the rate in bits.*/
+    unsigned int rate;
+    /** The position in the states of the next byte to be input (when absorbing) or output (when squeezing). */
+    unsigned int byteIOIndex;
+    /** If set to 0, in the absorbing phase; otherwise, in the squeezing phase. */
+    int squeezing;
+} KeccakTimes8_SpongeInstance;
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/**
+  * Function to initialize eight Keccak[r, c] sponge functions.
+  * @pre    The CPU supports AVX-512F.
+  * @return Zero if successful, 1 otherwise.
+  * @see    Keccak_SpongeInitialize()
+  */
+int KeccakTimes8_SpongeInitialize(KeccakTimes8_SpongeInstance *spongeInstance, unsigned int rate, unsigned int capacity);
+
+/**
+  * Function to give the same number of input bytes to each of the eight sponges.
+  * @param  data            Pointer to the input data of the first instance.
+  * @param  instanceStride  Distance in bytes between the input data of two consecutive instances.
+  * @param  dataByteLen     The number of input bytes provided to each instance.
+  * @return Zero if successful, 1 otherwise.
+  * @see    Keccak_SpongeAbsorb()
+  */
+int KeccakTimes8_SpongeAbsorb(KeccakTimes8_SpongeInstance *spongeInstance, const unsigned char *data, size_t instanceStride, size_t dataByteLen);
+
+/**
+  * Function to absorb the same trailing bits into the eight sponges
+  * and then to switch to the squeezing phase.
+  * @return Zero if successful, 1 otherwise.
+  * @see    Keccak_SpongeAbsorbLastFewBits()
+  */
+int KeccakTimes8_SpongeAbsorbLastFewBits(KeccakTimes8_SpongeInstance *spongeInstance, unsigned char delimitedData);
+
+/**
+  * Function to squeeze the same number of output bytes from each of the eight sponges.
+  * @param  data            Pointer to the output area of the first instance.
+  * @param  instanceStride  Distance in bytes between the output areas of two consecutive instances.
+  * @param  dataByteLen     The number of output bytes desired from each instance.
+  * @return Zero if successful, 1 otherwise.
+  * @see    Keccak_SpongeSqueeze()
+  */
+int KeccakTimes8_SpongeSqueeze(KeccakTimes8_SpongeInstance *spongeInstance, unsigned char *data, size_t instanceStride, size_t dataByteLen);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif
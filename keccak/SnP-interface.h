@@ -18,6 +18,10 @@
 #endif
 #endif
 
+#if defined(USE_KECCAK_DISPATCH)
+#include "KeccakF-1600/Dispatch/SnP-interface.h"
+#else
+
 #ifdef ENV32BIT
 #include "KeccakF-1600/Inplace32BI/SnP-interface.h"
 #endif
@@ -26,5 +30,7 @@
 #include "KeccakF-1600/Optimized64/SnP-interface.h"
 #endif
 
+#endif
+
 
 #endif
\ No newline at end of file
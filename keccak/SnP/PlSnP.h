@@ -0,0 +1,95 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef _PlSnP_h_
+#define _PlSnP_h_
+
+// Parallel state-and-permutation (PlSnP) interface.
+// This is the counterpart of SnP.h for implementations that process
+// PlSnP_parallelism independent states in lockstep. Each implementation
+// provides a PlSnP-interface.h that maps the names below to its own symbols.
+// Bulk functions take an @a instanceStride: the data of instance i starts
+// at @a data + i * @a instanceStride.
+
+/** Function called at least once before any use of the other PlSnP_*
+  * functions, possibly to initialize global variables.
+  */
+void PlSnP_StaticInitialize( void );
+
+/** Function to initialize all the states to the logical value 0^width.
+  * @param  states  Pointer to the states, aligned on PlSnP_statesAlignment bytes.
+  */
+void PlSnP_InitializeAll(void *states);
+
+/** Function to XOR data given as bytes into one of the states.
+  * @param  states  Pointer to the states.
+  * @param  instanceIndex   Index of the state to modify.
+  * @param  data    Pointer to the input data.
+  * @param  offset  Offset in bytes within the state.
+  * @param  length  Number of bytes.
+  * @pre    0 ≤ @a instanceIndex < PlSnP_parallelism
+  * @pre    0 ≤ @a offset + @a length ≤ (width in bytes)
+  */
+void PlSnP_XORBytes(void *states, unsigned int instanceIndex, const unsigned char *data, unsigned int offset, unsigned int length);
+
+/** Function to XOR whole lanes into all the states at once.
+  * @param  states  Pointer to the states.
+  * @param  data    Pointer to the input data of the first instance.
+  * @param  laneCount   The number of lanes to XOR in each state.
+  * @param  instanceStride  Distance in bytes between the data of two consecutive instances.
+  * @pre    0 ≤ @a laneCount ≤ 25
+  */
+void PlSnP_XORLanesAll(void *states, const unsigned char *data, unsigned int laneCount, size_t instanceStride);
+
+/** Function to apply Keccak-f on all the states.
+  * @param  states  Pointer to the states.
+  */
+void PlSnP_PermuteAll(void *states);
+
+/** Function to retrieve data from one of the states into bytes.
+  * @param  states  Pointer to the states.
+  * @param  instanceIndex   Index of the state to read.
+  * @param  data    Pointer to the area where to store output data.
+  * @param  offset  Offset in bytes within the state.
+  * @param  length  Number of bytes.
+  * @pre    0 ≤ @a instanceIndex < PlSnP_parallelism
+  * @pre    0 ≤ @a offset + @a length ≤ (width in bytes)
+  */
+void PlSnP_ExtractBytes(const void *states, unsigned int instanceIndex, unsigned char *data, unsigned int offset, unsigned int length);
+
+/** Function to retrieve whole lanes from all the states at once.
+  * @param  states  Pointer to the states.
+  * @param  data    Pointer to the output area of the first instance.
+  * @param  laneCount   The number of lanes to retrieve from each state.
+  * @param  instanceStride  Distance in bytes between the output areas of two consecutive instances.
+  * @pre    0 ≤ @a laneCount ≤ 25
+  */
+void PlSnP_ExtractLanesAll(const void *states, unsigned char *data, unsigned int laneCount, size_t instanceStride);
+
+/** Function that has the same behavior as SnP_FBWL_Absorb() applied to
+  * every instance, instance i reading from @a data + i * @a instanceStride.
+  * @param  states  Pointer to the states.
+  * @param  laneCount   The number of lanes processed each time (i.e., the block size in lanes).
+  * @param  data    Pointer to the input data of the first instance.
+  * @param  instanceStride  Distance in bytes between the data of two consecutive instances.
+  * @param  dataByteLen The length of the input data of each instance in bytes.
+  * @param  trailingBits    The byte to XOR at the end of each block.
+  * @returns    The number of bytes processed for each instance.
+  * @pre    0 < @a laneCount < 25
+  */
+size_t PlSnP_FBWL_Absorb(void *states, unsigned int laneCount, const unsigned char *data, size_t instanceStride, size_t dataByteLen, unsigned char trailingBits);
+
+/** Function that has the same behavior as SnP_FBWL_Squeeze() applied to
+  * every instance, instance i writing to @a data + i * @a instanceStride.
+  * @param  states  Pointer to the states.
+  * @param  laneCount   The number of lanes processed each time (i.e., the block size in lanes).
+  * @param  data    Pointer to the output area of the first instance.
+  * @param  instanceStride  Distance in bytes between the output areas of two consecutive instances.
+  * @param  dataByteLen The length of the output area of each instance in bytes.
+  * @returns    The number of bytes produced for each instance.
+  * @pre    0 < @a laneCount ≤ 25
+  */
+size_t PlSnP_FBWL_Squeeze(void *states, unsigned int laneCount, unsigned char *data, size_t instanceStride, size_t dataByteLen);
+
+#endif
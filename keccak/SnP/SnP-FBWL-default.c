@@ -59,6 +59,22 @@ size_t SnP_FBWL_Squeeze_Default(void *state, unsigned int laneCount, unsigned ch
     return processed;
 }
 
+size_t SnP_FBWL_SqueezeAbsorb_Default(void *squeezeState, void *absorbState, unsigned int laneCount, size_t dataByteLen)
+{
+    size_t processed = 0;
+    unsigned char block[SnP_width/8];
+
+    while(dataByteLen >= laneCount*SnP_laneLengthInBytes) {
+        SnP_Permute(squeezeState);
+        SnP_ExtractBytes(squeezeState, block, 0, laneCount*SnP_laneLengthInBytes);
+        SnP_XORBytes(absorbState, block, 0, laneCount*SnP_laneLengthInBytes);
+        SnP_Permute(absorbState);
+        dataByteLen -= laneCount*SnP_laneLengthInBytes;
+        processed += laneCount*SnP_laneLengthInBytes;
+    }
+    return processed;
+}
+
 size_t SnP_FBWL_Wrap_Default(void *state, unsigned int laneCount, const unsigned char *dataIn, unsigned char *dataOut, size_t dataByteLen, unsigned char trailingBits)
 {
     size_t processed = 0;
@@ -133,6 +133,20 @@ size_t SnP_FBWL_Absorb(void *state, unsigned int laneCount, const unsigned char
   */
 size_t SnP_FBWL_Squeeze(void *state, unsigned int laneCount, unsigned char *data, size_t dataByteLen);
 
+/** Function that has the same behavior as repeatedly calling
+  *  - SnP_FBWL_Squeeze() with a block of @a laneCount lanes on @a squeezeState;
+  *  - SnP_FBWL_Absorb() with that block and no trailing bits on @a absorbState;
+  *  - and decrementing @a dataByteLen by @a laneCount lane sizes, until it is smaller than a block.
+  * The blocks are not written to memory, so that two chained sponges need no buffer in between.
+  * @param  squeezeState    Pointer to the state to squeeze from.
+  * @param  absorbState     Pointer to the state to absorb into.
+  * @param  laneCount   The number of lanes processed each time (i.e., the block size in lanes).
+  * @param  dataByteLen The number of bytes to transfer.
+  * @returns    The number of bytes transferred.
+  * @pre    0 < @a laneCount < 25
+  */
+size_t SnP_FBWL_SqueezeAbsorb(void *squeezeState, void *absorbState, unsigned int laneCount, size_t dataByteLen);
+
 /** Function that has the same behavior as repeatedly calling
   *  - SnP_ExtractAndXORBytes() with a block of @a laneCount lanes from @a dataIn to @a dataOut;
   *  - SnP_OverwriteBytes() with the block of @a laneCount lanes just produced in @a dataOut;
@@ -41,10 +41,9 @@ KeccakSponge.h
 unsigned char *SHA3_224(const unsigned char *dataIn, size_t nBytesIn, unsigned char *md)
 {
     Keccak_HashInstance h;
-    static BitSequence  m[SHA3_224_DL];
 
     if (md == NULL) {
-        md = m;
+        return NULL;
     }
     Keccak_HashInitialize_SHA3_224(&h);
     Keccak_HashUpdate(&h, dataIn, (DataLength)nBytesIn * 8);
@@ -56,10 +55,9 @@ unsigned char *SHA3_224(const unsigned char *dataIn, size_t nBytesIn, unsigned c
 unsigned char *SHA3_256(const unsigned char *dataIn, size_t nBytesIn, unsigned char *md)
 {
     Keccak_HashInstance h;
-    static BitSequence  m[SHA3_256_DL];
 
     if (md == NULL) {
-        md = m;
+        return NULL;
     }
     Keccak_HashInitialize_SHA3_256(&h);
     Keccak_HashUpdate(&h, dataIn, (DataLength)nBytesIn * 8);
@@ -71,10 +69,9 @@ unsigned char *SHA3_256(const unsigned char *dataIn, size_t nBytesIn, unsigned c
 unsigned char *SHA3_384(const unsigned char *dataIn, size_t nBytesIn, unsigned char *md)
 {
     Keccak_HashInstance h;
-    static BitSequence  m[SHA3_384_DL];
 
     if (md == NULL) {
-        md = m;
+        return NULL;
     }
     Keccak_HashInitialize_SHA3_384(&h);
     Keccak_HashUpdate(&h, dataIn, (DataLength)nBytesIn * 8);
@@ -86,10 +83,9 @@ unsigned char *SHA3_384(const unsigned char *dataIn, size_t nBytesIn, unsigned c
 unsigned char *SHA3_512(const unsigned char *dataIn, size_t nBytesIn, unsigned char *md)
 {
     Keccak_HashInstance h;
-    static BitSequence  m[SHA3_512_DL];
 
     if (md == NULL) {
-        md = m;
+        return NULL;
     }
     Keccak_HashInitialize_SHA3_512(&h);
     Keccak_HashUpdate(&h, dataIn, (DataLength)nBytesIn * 8);
@@ -141,10 +137,9 @@ int SHAKE256(const unsigned char *dataIn, size_t nBitsIn, unsigned char *md, int
 unsigned char *SHA3_320(const unsigned char *dataIn, size_t nBytesIn, unsigned char *md)
 {
     Keccak_HashInstance h;
-    static BitSequence  m[SHA3_320_DL];
 
     if (md == NULL) {
-        md = m;
+        return NULL;
     }
     Keccak_HashInitialize(&h, SHA3_320_R, SHA3_320_C, SHA3_320_L, SHA3_320_P);
     Keccak_HashUpdate(&h, dataIn, (DataLength)nBytesIn * 8);
@@ -171,6 +166,30 @@ int SHAKE320(const unsigned char *dataIn, size_t nBitsIn, unsigned char *md, int
     return nOutBytes;
 }
 
+// SHAKE320 of the first nChainBytes of the SHAKE320 of dataIn.
+// The intermediate output is never stored: the two sponges run side by side.
+int SHAKE320_Chained(const unsigned char *dataIn, size_t nBitsIn, size_t nChainBytes, unsigned char *md, int nOutBytes)
+{
+    Keccak_HashInstance inner;
+    Keccak_HashInstance outer;
+
+    if (md == NULL || nOutBytes == 0) {
+        return 0;
+    }
+    if (nOutBytes > SHAKE_MAX_BITS / 8) {
+        nOutBytes = SHAKE_MAX_BITS / 8;
+    }
+    Keccak_HashInitialize(&inner, SHAKE320_R, SHAKE320_C, 0, SHAKE320_P);
+    Keccak_HashUpdate(&inner, dataIn, (DataLength)nBitsIn);
+    Keccak_HashFinal(&inner, NULL);
+    Keccak_HashInitialize(&outer, SHAKE320_R, SHAKE320_C, 0, SHAKE320_P);
+    Keccak_SpongeSqueezeIntoAbsorb(&inner.sponge, &outer.sponge, nChainBytes);
+    Keccak_HashFinal(&outer, NULL);
+    Keccak_HashSqueeze(&outer, md, nOutBytes * 8);
+
+    return nOutBytes;
+}
+
 int SHAKE160(const unsigned char *dataIn, size_t nBitsIn, unsigned char *md, int nOutBytes)
 {
     Keccak_HashInstance h;
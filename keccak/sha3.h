@@ -32,6 +32,9 @@
 extern "C" {
 #endif
 
+// The SHA3_* functions write the digest to md and return it. Unlike their
+// OpenSSL counterparts they have no static buffer to fall back on: a NULL md
+// is not written and NULL is returned.
 extern unsigned char *SHA3_224(const unsigned char *dataIn, size_t nBytesIn, unsigned char *md);
 extern unsigned char *SHA3_256(const unsigned char *dataIn, size_t nBytesIn, unsigned char *md);
 extern unsigned char *SHA3_384(const unsigned char *dataIn, size_t nBytesIn, unsigned char *md);
@@ -77,6 +80,7 @@ extern unsigned char *SHA3_320(const unsigned char *dataIn, size_t nBytesIn, uns
 extern           int   SHAKE80(const unsigned char *dataIn, size_t  nBitsIn, unsigned char *md, int nOutBytes);
 extern           int  SHAKE160(const unsigned char *dataIn, size_t  nBitsIn, unsigned char *md, int nOutBytes);
 extern           int  SHAKE320(const unsigned char *dataIn, size_t  nBitsIn, unsigned char *md, int nOutBytes);
+extern           int  SHAKE320_Chained(const unsigned char *dataIn, size_t  nBitsIn, size_t nChainBytes, unsigned char *md, int nOutBytes);
 
 #if defined (__cplusplus)
 }
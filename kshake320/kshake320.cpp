@@ -0,0 +1,98 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#define KSHAKE320_BUILDING
+#include "kshake320.h"
+#include "pow.h"
+#include "../crypto/ripemd160.h"
+#include "../crypto/sha256.h"
+
+#include <new>
+#include <thread>
+
+int kshake320_init(void)
+{
+    return KSHAKE320Initialize();
+}
+
+const char *kshake320_backend(void)
+{
+    return KSHAKE320Backend();
+}
+
+void kshake320_pow(const unsigned char *header, unsigned char *hash)
+{
+    KSHAKE320POW((const char *)header, (char *)hash);
+}
+
+void kshake320_pow_scratchpad(const unsigned char *header, unsigned char *hash, unsigned char *scratchpad)
+{
+    KSHAKE320POW((const char *)header, (char *)hash, scratchpad);
+}
+
+int kshake320_pow_batch(const unsigned char *headers, size_t count, unsigned char *hashes, unsigned int threads)
+{
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    try {
+        if (threads <= 1 || count <= 8)
+            KSHAKE320POWBatch((const char *)headers, count, (char *)hashes);
+        else
+            KSHAKE320POWBatchThreaded((const char *)headers, count, (char *)hashes, threads);
+    }
+    catch (const std::bad_alloc &) {
+        return -1;
+    }
+    return 0;
+}
+
+void kshake320_hash320(const unsigned char *data, size_t len, unsigned char *hash)
+{
+    GetHash320((const char *)data, len, (char *)hash);
+}
+
+void kshake320_hash256(const unsigned char *data, size_t len, unsigned char *hash)
+{
+    GetHash256((const char *)data, len, (char *)hash);
+}
+
+void kshake320_sha256d(const unsigned char *data, size_t len, unsigned char *hash)
+{
+    Sha256d(data, len, hash);
+}
+
+void kshake320_hash160(const unsigned char *data, size_t len, unsigned char *hash)
+{
+    Hash160(data, len, hash);
+}
+
+const char *kshake320_sha256_backend(void)
+{
+    return Sha256_Implementation();
+}
+
+int kshake320_scan(const unsigned char *header, unsigned int nonce_offset, uint64_t start, uint64_t count,
+                   const unsigned char *target, uint32_t *nonces, unsigned char *hashes, size_t capacity, size_t *found)
+{
+    if (nonce_offset > KSHAKE320_HEADER_BYTES - 4 || start > ((uint64_t)1 << 32) || count > ((uint64_t)1 << 32) - start)
+        return -2;
+
+    uint320 target320;
+    memcpy(target320.begin(), target, KSHAKE320_HASH_BYTES);
+    std::vector<std::pair<uint32_t, uint320> > results;
+    try {
+        KSHAKE320Midstate midstate((const char *)header, nonce_offset);
+        KSHAKE320Scan(midstate, start, count, target320, results);
+    }
+    catch (const std::bad_alloc &) {
+        return -1;
+    }
+    for (size_t i = 0; i < results.size() && i < capacity; i++) {
+        nonces[i] = results[i].first;
+        if (hashes != NULL)
+            memcpy(hashes + i * KSHAKE320_HASH_BYTES, results[i].second.begin(), KSHAKE320_HASH_BYTES);
+    }
+    *found = results.size();
+    return 0;
+}
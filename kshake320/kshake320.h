@@ -0,0 +1,100 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef KSHAKE320_H
+#define KSHAKE320_H
+
+// C interface of libkshake320, the Kryptohash PoW and hashes without Python.
+// All functions are thread-safe once kshake320_init() has returned.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32) && defined(KSHAKE320_SHARED)
+#ifdef KSHAKE320_BUILDING
+#define KSHAKE320_API __declspec(dllexport)
+#else
+#define KSHAKE320_API __declspec(dllimport)
+#endif
+#elif defined(__GNUC__)
+#define KSHAKE320_API __attribute__((visibility("default")))
+#else
+#define KSHAKE320_API
+#endif
+
+#define KSHAKE320_VERSION "1.0"
+
+#define KSHAKE320_HEADER_BYTES      120    // Block header
+#define KSHAKE320_HASH_BYTES        40     // kshake320_pow and kshake320_hash320
+#define KSHAKE320_HASH256_BYTES     32     // kshake320_hash256 and kshake320_sha256d
+#define KSHAKE320_HASH160_BYTES     20     // kshake320_hash160
+#define KSHAKE320_SCRATCHPAD_BYTES  65520  // Scratchpad of a v2 PoW
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/**
+  * Selects the Keccak backend and the SHA-256 implementation from the CPU
+  * features, or from the environment variables KSHAKE320_BACKEND and
+  * KSHAKE320_SHA256. Only the first call does it; the functions below run on
+  * the portable implementations until then.
+  * @return Zero if successful, 1 if one of the variables names an unknown or
+  *         unsupported implementation, in which case the detected one is used.
+  */
+KSHAKE320_API int kshake320_init(void);
+
+/** Name of the Keccak backend in use: "scalar", "avx2" or "avx512". */
+KSHAKE320_API const char *kshake320_backend(void);
+
+/** PoW hash of a 120-byte header, v1 or v2 after the version at its start. */
+KSHAKE320_API void kshake320_pow(const unsigned char *header, unsigned char *hash);
+
+/**
+  * kshake320_pow with a caller-provided scratchpad of
+  * KSHAKE320_SCRATCHPAD_BYTES bytes, which v2 headers otherwise allocate.
+  */
+KSHAKE320_API void kshake320_pow_scratchpad(const unsigned char *header, unsigned char *hash, unsigned char *scratchpad);
+
+/**
+  * PoW hashes of count contiguous 120-byte headers into count contiguous
+  * 40-byte hashes, with the parallel Keccak kernel of the backend if it has
+  * one, split between threads threads, the calling one included. 0 threads
+  * means one per CPU.
+  * @return Zero if successful, -1 if out of memory.
+  */
+KSHAKE320_API int kshake320_pow_batch(const unsigned char *headers, size_t count, unsigned char *hashes, unsigned int threads);
+
+/** SHAKE320 of len bytes, truncated to 40 bytes. */
+KSHAKE320_API void kshake320_hash320(const unsigned char *data, size_t len, unsigned char *hash);
+
+/** SHA3-256 of the SHA3-256 of len bytes. */
+KSHAKE320_API void kshake320_hash256(const unsigned char *data, size_t len, unsigned char *hash);
+
+/** SHA-256 of the SHA-256 of len bytes, Bitcoin's Hash(). */
+KSHAKE320_API void kshake320_sha256d(const unsigned char *data, size_t len, unsigned char *hash);
+
+/** RIPEMD-160 of the SHA-256 of len bytes, Bitcoin's Hash160(). */
+KSHAKE320_API void kshake320_hash160(const unsigned char *data, size_t len, unsigned char *hash);
+
+/** Name of the SHA-256 implementation in use: "generic" or "shani". */
+KSHAKE320_API const char *kshake320_sha256_backend(void);
+
+/**
+  * Hashes the header for every nonce in [start, start + count), the nonce
+  * being the little-endian uint32 at nonce_offset, and collects the nonces
+  * whose hash read as a little-endian 320-bit number does not exceed target.
+  * The first capacity of them are stored in nonces, and their hashes in
+  * hashes unless it is NULL; *found is set to how many there are in all.
+  * @return Zero if successful, -1 if out of memory, -2 if nonce_offset is
+  *         over 116 or the range goes past 2**32.
+  */
+KSHAKE320_API int kshake320_scan(const unsigned char *header, unsigned int nonce_offset, uint64_t start, uint64_t count,
+                                 const unsigned char *target, uint32_t *nonces, unsigned char *hashes, size_t capacity, size_t *found);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif
@@ -0,0 +1,276 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef KSHAKE320_METRICS_H
+#define KSHAKE320_METRICS_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define KSHAKE320_METRICS_TSC 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+// Counts of the calls into the module, kept by every thread in a block of
+// its own, which only it writes, so that recording a call takes neither a
+// lock nor an atomic read-modify-write. Readers add up the blocks of all the
+// threads. The block of a thread that ends goes to the next thread started,
+// its counts included. Durations are in ticks of the time-stamp counter on
+// x86 and in nanoseconds elsewhere; TicksPerSecond converts them.
+class KSHAKE320Metrics
+{
+public:
+    enum Entry {
+        GETPOWHASH, GETPOWHASHBATCH, GETPOWHASHARRAY, GETHASH320, GETHASH256,
+        GETSHA256D, GETHASH160, SCAN, POWJOB_HASH, POWJOB_SCAN, NONCESEARCHER_SEARCH, ENTRY_COUNT
+    };
+
+    // Bucket 0 counts the calls of no tick, bucket i those of 2**(i-1) to
+    // 2**i - 1 ticks, the last one those longer still.
+    enum { LATENCY_BUCKETS = 48 };
+
+    struct EntryTotals
+    {
+        uint64_t calls;
+        uint64_t bytes;
+        uint64_t ticks;
+        uint64_t latency[LATENCY_BUCKETS];
+    };
+
+    struct Totals
+    {
+        // v1 and v2 headers hashed by all the entry points and pools
+        uint64_t powHashes[2];
+        EntryTotals entries[ENTRY_COUNT];
+    };
+
+    static const char *EntryName(int entry)
+    {
+        static const char *const names[ENTRY_COUNT] = {
+            "getPoWHash", "getPoWHashBatch", "getPoWHashArray", "getHash320", "getHash256",
+            "getSHA256d", "getHash160", "scan", "PowJob.hash", "PowJob.scan", "NonceSearcher.search",
+        };
+        return names[entry];
+    }
+
+    static uint64_t Ticks()
+    {
+#if KSHAKE320_METRICS_TSC
+        return __rdtsc();
+#else
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    // Starts the clock of TicksPerSecond, when the module is loaded.
+    static void Start()
+    {
+        Origin();
+    }
+
+    // Measured against the steady clock since Start, waiting until 10 ms
+    // have passed if needed; the estimate gets better with time.
+    static double TicksPerSecond()
+    {
+#if KSHAKE320_METRICS_TSC
+        const Reference &origin = Origin();
+        std::chrono::duration<double> elapsed = Clock::now() - origin.time;
+        if (elapsed.count() < 0.01) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(0.01) - elapsed);
+            elapsed = Clock::now() - origin.time;
+        }
+        return (double)(Ticks() - origin.ticks) / elapsed.count();
+#else
+        return 1e9;
+#endif
+    }
+
+    // A call of entry that hashed bytes in the given ticks.
+    static void Record(Entry entry, uint64_t bytes, uint64_t ticks)
+    {
+        BlockEntry &e = Local().entries[entry];
+        Add(e.calls, 1);
+        Add(e.bytes, bytes);
+        Add(e.ticks, ticks);
+        // The number of significant bits of ticks
+        unsigned int bucket = 0;
+#if defined(__GNUC__)
+        bucket = ticks == 0 ? 0 : 64 - __builtin_clzll(ticks);
+#else
+        while (bucket < 64 && (ticks >> bucket) != 0)
+            bucket++;
+#endif
+        Add(e.latency[bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1], 1);
+    }
+
+    static void RecordPoW(bool v2, uint64_t hashes)
+    {
+        Add(Local().powHashes[v2 ? 1 : 0], hashes);
+    }
+
+    // Counts the v1 and v2 headers of a batch of 120-byte headers.
+    static void RecordPoWHeaders(const char *headers, size_t count)
+    {
+        uint64_t v2 = 0;
+        for (size_t i = 0; i < count; i++) {
+            int version;
+            memcpy(&version, headers + i * 120, sizeof(version));
+            v2 += version > 1;
+        }
+        RecordPoW(false, count - v2);
+        RecordPoW(true, v2);
+    }
+
+    // The totals since the last Reset.
+    static void Read(Totals &totals)
+    {
+        Sum(totals);
+        std::lock_guard<std::mutex> lock(BaselineMutex());
+        const Totals &baseline = Baseline();
+        for (int v = 0; v < 2; v++)
+            totals.powHashes[v] -= baseline.powHashes[v];
+        for (int i = 0; i < ENTRY_COUNT; i++) {
+            totals.entries[i].calls -= baseline.entries[i].calls;
+            totals.entries[i].bytes -= baseline.entries[i].bytes;
+            totals.entries[i].ticks -= baseline.entries[i].ticks;
+            for (int b = 0; b < LATENCY_BUCKETS; b++)
+                totals.entries[i].latency[b] -= baseline.entries[i].latency[b];
+        }
+    }
+
+    // The blocks are only written by their threads: resetting sets the
+    // totals aside to subtract them from those read later.
+    static void Reset()
+    {
+        Totals totals;
+        Sum(totals);
+        std::lock_guard<std::mutex> lock(BaselineMutex());
+        Baseline() = totals;
+    }
+
+private:
+    typedef std::atomic<uint64_t> Counter;
+    typedef std::chrono::steady_clock Clock;
+
+    struct Reference
+    {
+        Clock::time_point time;
+        uint64_t ticks;
+    };
+
+    struct BlockEntry
+    {
+        Counter calls;
+        Counter bytes;
+        Counter ticks;
+        Counter latency[LATENCY_BUCKETS];
+    };
+
+    struct Block
+    {
+        Counter powHashes[2];
+        BlockEntry entries[ENTRY_COUNT];
+        std::atomic<bool> inUse;
+        Block *next;
+    };
+
+    // Gives the block of a thread back when it ends.
+    struct Slot
+    {
+        Block *block;
+        Slot() : block(Acquire()) {}
+        ~Slot() { block->inUse.store(false, std::memory_order_release); }
+    };
+
+    // Only the owner writes, so a plain store of the sum is enough.
+    static void Add(Counter &counter, uint64_t n)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static const Reference &Origin()
+    {
+        static const Reference origin = { Clock::now(), Ticks() };
+        return origin;
+    }
+
+    static std::atomic<Block *> &Head()
+    {
+        static std::atomic<Block *> head(nullptr);
+        return head;
+    }
+
+    static std::mutex &BaselineMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static Totals &Baseline()
+    {
+        static Totals baseline;
+        return baseline;
+    }
+
+    // The pointer needs no guard, unlike the slot with its destructor, which
+    // is only reached once per thread.
+    static Block &Local()
+    {
+        static thread_local Block *block = nullptr;
+        if (block == nullptr) {
+            static thread_local Slot slot;
+            block = slot.block;
+        }
+        return *block;
+    }
+
+    // A block given back by a thread that ended, or a new one. The blocks
+    // are never freed, so the list only grows, up to the largest number of
+    // threads that recorded calls at once.
+    static Block *Acquire()
+    {
+        for (Block *b = Head().load(std::memory_order_acquire); b != nullptr; b = b->next) {
+            bool expected = false;
+            if (!b->inUse.load(std::memory_order_relaxed)
+                && b->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire))
+                return b;
+        }
+        Block *b = new Block();
+        b->inUse.store(true, std::memory_order_relaxed);
+        b->next = Head().load(std::memory_order_relaxed);
+        while (!Head().compare_exchange_weak(b->next, b, std::memory_order_release, std::memory_order_relaxed))
+            ;
+        return b;
+    }
+
+    static void Sum(Totals &totals)
+    {
+        memset(&totals, 0, sizeof(totals));
+        for (Block *b = Head().load(std::memory_order_acquire); b != nullptr; b = b->next) {
+            for (int v = 0; v < 2; v++)
+                totals.powHashes[v] += b->powHashes[v].load(std::memory_order_relaxed);
+            for (int i = 0; i < ENTRY_COUNT; i++) {
+                const BlockEntry &e = b->entries[i];
+                totals.entries[i].calls += e.calls.load(std::memory_order_relaxed);
+                totals.entries[i].bytes += e.bytes.load(std::memory_order_relaxed);
+                totals.entries[i].ticks += e.ticks.load(std::memory_order_relaxed);
+                for (int k = 0; k < LATENCY_BUCKETS; k++)
+                    totals.entries[i].latency[k] += e.latency[k].load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+#endif // KSHAKE320_METRICS_H
@@ -0,0 +1,168 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "perf.h"
+
+#include <string.h>
+
+static const char *const KSHAKE320PhaseNames[KSHAKE320_PHASE_COUNT] = {
+    "v1_absorb", "v1_squeeze_absorb", "v1_final_squeeze",
+    "v2_absorb", "v2_squeeze", "v2_reversed_absorb", "v2_final_squeeze",
+};
+
+static const char *const KSHAKE320CounterNames[KSHAKE320_COUNTER_COUNT] = {
+    "cycles", "instructions", "l1d_misses", "llc_misses", "task_clock_ns",
+};
+
+const char *KSHAKE320PhaseName(int phase)
+{
+    return (phase >= 0 && phase < KSHAKE320_PHASE_COUNT) ? KSHAKE320PhaseNames[phase] : NULL;
+}
+
+const char *KSHAKE320CounterName(int counter)
+{
+    return (counter >= 0 && counter < KSHAKE320_COUNTER_COUNT) ? KSHAKE320CounterNames[counter] : NULL;
+}
+
+#ifdef KSHAKE320_PERF_COUNTERS
+
+#ifndef __linux__
+#error "KSHAKE320_PERF_COUNTERS needs perf_event_open, which only Linux has"
+#endif
+
+#include <atomic>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+namespace {
+
+struct PerfEvent
+{
+    uint32_t type;
+    uint64_t config;
+};
+
+#define KSHAKE320_CACHE_READ_MISS(cache) \
+    ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+const PerfEvent perfEvents[KSHAKE320_COUNTER_COUNT] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HW_CACHE, KSHAKE320_CACHE_READ_MISS(PERF_COUNT_HW_CACHE_L1D) },
+    { PERF_TYPE_HW_CACHE, KSHAKE320_CACHE_READ_MISS(PERF_COUNT_HW_CACHE_LL) },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+};
+
+std::atomic<uint64_t> totalHashes[KSHAKE320_PHASE_COUNT];
+std::atomic<uint64_t> totals[KSHAKE320_PHASE_COUNT][KSHAKE320_COUNTER_COUNT];
+// One bit per counter opened by some thread
+std::atomic<unsigned int> opened(0);
+
+// The counters of one thread, opened as one group so that a single read()
+// returns them all. Those the kernel or the CPU refuse are left out.
+class ThreadCounters
+{
+public:
+    ThreadCounters() : leader(-1), count(0)
+    {
+        for (int c = 0; c < KSHAKE320_COUNTER_COUNT; c++) {
+            struct perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = perfEvents[c].type;
+            attr.config = perfEvents[c].config;
+            attr.read_format = PERF_FORMAT_GROUP;
+            // Allowed with the default perf_event_paranoid of 2
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            // This thread, on any CPU
+            int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0);
+            if (fd < 0)
+                continue;
+            if (leader < 0)
+                leader = fd;
+            fds[count] = fd;
+            slots[count++] = c;
+            opened.fetch_or(1u << c, std::memory_order_relaxed);
+        }
+        memset(last, 0, sizeof(last));
+    }
+
+    ~ThreadCounters()
+    {
+        // The leader last
+        for (int i = count - 1; i >= 0; i--)
+            close(fds[i]);
+    }
+
+    void Read(uint64_t values[KSHAKE320_COUNTER_COUNT])
+    {
+        uint64_t group[1 + KSHAKE320_COUNTER_COUNT];
+        memset(values, 0, KSHAKE320_COUNTER_COUNT * sizeof(uint64_t));
+        if (leader < 0 || read(leader, group, (1 + count) * sizeof(uint64_t)) != (ssize_t)((1 + count) * sizeof(uint64_t)))
+            return;
+        for (int i = 0; i < count; i++)
+            values[slots[i]] = group[1 + i];
+    }
+
+    // At the start of the current phase
+    uint64_t last[KSHAKE320_COUNTER_COUNT];
+
+private:
+    int leader;
+    int count;
+    int fds[KSHAKE320_COUNTER_COUNT];
+    int slots[KSHAKE320_COUNTER_COUNT];
+};
+
+ThreadCounters &Counters()
+{
+    static thread_local ThreadCounters counters;
+    return counters;
+}
+
+}  // namespace
+
+void KSHAKE320PerfStart()
+{
+    ThreadCounters &counters = Counters();
+    counters.Read(counters.last);
+}
+
+void KSHAKE320PerfLap(KSHAKE320Phase phase, unsigned int hashes)
+{
+    ThreadCounters &counters = Counters();
+    uint64_t now[KSHAKE320_COUNTER_COUNT];
+    counters.Read(now);
+    for (int c = 0; c < KSHAKE320_COUNTER_COUNT; c++) {
+        totals[phase][c].fetch_add(now[c] - counters.last[c], std::memory_order_relaxed);
+        counters.last[c] = now[c];
+    }
+    totalHashes[phase].fetch_add(hashes, std::memory_order_relaxed);
+}
+
+bool KSHAKE320PerfStats(KSHAKE320PhaseStats stats[KSHAKE320_PHASE_COUNT], bool available[KSHAKE320_COUNTER_COUNT])
+{
+    for (int p = 0; p < KSHAKE320_PHASE_COUNT; p++) {
+        stats[p].hashes = totalHashes[p].load(std::memory_order_relaxed);
+        for (int c = 0; c < KSHAKE320_COUNTER_COUNT; c++)
+            stats[p].counters[c] = totals[p][c].load(std::memory_order_relaxed);
+    }
+    unsigned int mask = opened.load(std::memory_order_relaxed);
+    for (int c = 0; c < KSHAKE320_COUNTER_COUNT; c++)
+        available[c] = (mask & (1u << c)) != 0;
+    return true;
+}
+
+#else
+
+bool KSHAKE320PerfStats(KSHAKE320PhaseStats stats[KSHAKE320_PHASE_COUNT], bool available[KSHAKE320_COUNTER_COUNT])
+{
+    (void)stats;
+    (void)available;
+    return false;
+}
+
+#endif
@@ -0,0 +1,72 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef KSHAKE320_PERF_H
+#define KSHAKE320_PERF_H
+
+#include <stdint.h>
+
+// Hardware performance counters around the phases of the PoW, kept by the
+// builds with KSHAKE320_PERF_COUNTERS defined (Linux only, perf_event_open).
+// Each thread counts its own user-space events from its first PoW on, and
+// the counts of all the threads add up. The other builds keep no counters
+// and the phase markers compile to nothing.
+
+// v1 chains the squeezing of the first sponge into the second one, block by
+// block, and v2 absorbs the scratchpad in place, last block first, so that
+// neither has a phase of its own for moving blocks around.
+enum KSHAKE320Phase
+{
+    KSHAKE320_PHASE_V1_ABSORB,          // header into the first sponge, padding included
+    KSHAKE320_PHASE_V1_SQUEEZE_ABSORB,  // first sponge into the second one
+    KSHAKE320_PHASE_V1_FINAL_SQUEEZE,   // padding of the second sponge and the hash
+    KSHAKE320_PHASE_V2_ABSORB,
+    KSHAKE320_PHASE_V2_SQUEEZE,         // first sponge into the scratchpad
+    KSHAKE320_PHASE_V2_REVERSED_ABSORB, // scratchpad into the second sponge; with
+                                        // checkpoints, squeezing the segments again
+    KSHAKE320_PHASE_V2_FINAL_SQUEEZE,
+    KSHAKE320_PHASE_COUNT
+};
+
+enum KSHAKE320Counter
+{
+    KSHAKE320_COUNTER_CYCLES,
+    KSHAKE320_COUNTER_INSTRUCTIONS,
+    KSHAKE320_COUNTER_L1D_MISSES,       // L1 data cache read misses
+    KSHAKE320_COUNTER_LLC_MISSES,       // last-level cache read misses
+    KSHAKE320_COUNTER_TASK_CLOCK,       // nanoseconds on a CPU, from the kernel
+    KSHAKE320_COUNTER_COUNT
+};
+
+struct KSHAKE320PhaseStats
+{
+    // Headers hashed through the phase, the padding of SIMD groups included
+    uint64_t hashes;
+    uint64_t counters[KSHAKE320_COUNTER_COUNT];
+};
+
+// "v1_absorb", "cycles"...
+const char *KSHAKE320PhaseName(int phase);
+const char *KSHAKE320CounterName(int counter);
+
+// Copies the totals of the phases and tells which counters at least one
+// thread could open, virtual machines often having no hardware ones.
+// Returns false in the builds without KSHAKE320_PERF_COUNTERS.
+bool KSHAKE320PerfStats(KSHAKE320PhaseStats stats[KSHAKE320_PHASE_COUNT], bool available[KSHAKE320_COUNTER_COUNT]);
+
+#ifdef KSHAKE320_PERF_COUNTERS
+// Reads the counters of the calling thread at the start of a phase.
+void KSHAKE320PerfStart();
+// Adds the counts since the start or the last lap to phase, for hashes
+// headers, and starts the next phase.
+void KSHAKE320PerfLap(KSHAKE320Phase phase, unsigned int hashes);
+
+#define KSHAKE320_PERF_START() KSHAKE320PerfStart()
+#define KSHAKE320_PERF_LAP(phase, hashes) KSHAKE320PerfLap(phase, hashes)
+#else
+#define KSHAKE320_PERF_START() ((void)0)
+#define KSHAKE320_PERF_LAP(phase, hashes) ((void)0)
+#endif
+
+#endif // KSHAKE320_PERF_H
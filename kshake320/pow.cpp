@@ -0,0 +1,497 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "pow.h"
+#include "perf.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <thread>
+#include "../crypto/sha256.h"
+#ifdef USE_KECCAK_DISPATCH
+#include "../keccak/KeccakF-1600/Dispatch/KeccakF-1600-dispatch.h"
+#include "../keccak/KeccakSpongeTimes4.h"
+#include "../keccak/KeccakSpongeTimes8.h"
+#endif
+
+// Second pass of KryptoHash from the first-pass sponge once finalized, as in
+// SHAKE320_Chained.
+inline uint320 KryptoHashFinish(Keccak_HashInstance &inner)
+{
+    Keccak_HashInstance outer;
+    Keccak_HashInitialize(&outer, SHAKE320_R, SHAKE320_C, 0, SHAKE320_P);
+    Keccak_SpongeSqueezeIntoAbsorb(&inner.sponge, &outer.sponge, KPROOF_OF_WORK_SZ);
+    KSHAKE320_PERF_LAP(KSHAKE320_PHASE_V1_SQUEEZE_ABSORB, 1);
+
+    uint320 hash;
+    Keccak_HashFinal(&outer, NULL);
+    Keccak_HashSqueeze(&outer, (unsigned char*)&hash, SHAKE320_L);
+    KSHAKE320_PERF_LAP(KSHAKE320_PHASE_V1_FINAL_SQUEEZE, 1);
+    return hash;
+}
+
+// SHAKE320_Chained, with the first pass apart so that its phases can be told
+// apart by the KSHAKE320_PERF_COUNTERS build.
+template<typename T1>
+inline uint320 KryptoHash(const T1 pbegin, const T1 pend)
+{
+    static const unsigned char pblank[1] = { 0 };
+    // The KPROOF_OF_WORK_SZ bytes of the first pass go straight into the second
+    // one, block by block, so the working set is two Keccak states.
+    KSHAKE320_PERF_START();
+    Keccak_HashInstance inner;
+    Keccak_HashInitialize(&inner, SHAKE320_R, SHAKE320_C, 0, SHAKE320_P);
+    Keccak_HashUpdate(&inner, (pbegin == pend ? pblank : (const unsigned char*)&pbegin[0]), (pend - pbegin) * sizeof(pbegin[0]) * 8);
+    Keccak_HashFinal(&inner, NULL);
+    KSHAKE320_PERF_LAP(KSHAKE320_PHASE_V1_ABSORB, 1);
+    return KryptoHashFinish(inner);
+}
+
+// Number of blocks between two sponge states kept by the checkpointed v2 engine.
+// 0 selects the engine with a full scratchpad.
+#ifndef KSHAKE320_V2_CHECKPOINT_INTERVAL
+#define KSHAKE320_V2_CHECKPOINT_INTERVAL 0
+#endif
+
+static inline void SHAKE320AbsorbReversed(Keccak_HashInstance *h, const unsigned char *blocks, int blockCount)
+{
+    const unsigned char *p = blocks + blockCount * KRATE;
+    for (int i = 0; i < blockCount; i++)
+    {
+        p -= KRATE;
+        Keccak_HashUpdate(h, p, KRATE * 8);
+    }
+}
+
+// Second pass of KSHAKE320v2 from the first-pass sponge h1 once finalized.
+// scratchpad must hold KPROOF_OF_WORK_SZ bytes.
+inline uint320 KSHAKE320v2Finish(Keccak_HashInstance &h1, unsigned char *scratchpad)
+{
+    Keccak_HashSqueeze(&h1, scratchpad, KPROOF_OF_WORK_SZ * 8);
+    KSHAKE320_PERF_LAP(KSHAKE320_PHASE_V2_SQUEEZE, 1);
+
+    // Absorb the scratchpad in chunks of KRATE size, last one first
+    Keccak_HashInstance h;
+    Keccak_HashInitialize(&h, SHAKE320_R, SHAKE320_C, 0, SHAKE320_P);
+    SHAKE320AbsorbReversed(&h, scratchpad, KPOW_MUL);
+    KSHAKE320_PERF_LAP(KSHAKE320_PHASE_V2_REVERSED_ABSORB, 1);
+
+    uint320 hash;
+    Keccak_HashFinal(&h, NULL);
+    Keccak_HashSqueeze(&h, (unsigned char*)&hash, SHAKE320_L);
+    KSHAKE320_PERF_LAP(KSHAKE320_PHASE_V2_FINAL_SQUEEZE, 1);
+    return hash;
+}
+
+// scratchpad must hold KPROOF_OF_WORK_SZ bytes.
+template<typename T1>
+inline uint320 KSHAKE320v2(const T1 pbegin, const T1 pend, unsigned char *scratchpad)
+{
+    static const unsigned char pblank[1] = { 0 };
+    KSHAKE320_PERF_START();
+    Keccak_HashInstance h1;
+    Keccak_HashInitialize(&h1, SHAKE320_R, SHAKE320_C, 0, SHAKE320_P);
+    Keccak_HashUpdate(&h1, (pbegin == pend ? pblank : (const unsigned char*)&pbegin[0]), (pend - pbegin) * sizeof(pbegin[0]) * 8);
+    Keccak_HashFinal(&h1, NULL);
+    KSHAKE320_PERF_LAP(KSHAKE320_PHASE_V2_ABSORB, 1);
+    return KSHAKE320v2Finish(h1, scratchpad);
+}
+
+template<typename T1>
+inline uint320 KSHAKE320v2(const T1 pbegin, const T1 pend)
+{
+    unsigned char scratchpad[KPROOF_OF_WORK_SZ];
+    return KSHAKE320v2(pbegin, pend, scratchpad);
+}
+
+// Same result as KSHAKE320v2, keeping only the first-pass sponge state at
+// every K-th block instead of the scratchpad. The blocks of a segment are
+// squeezed again from its checkpoint when the second pass reaches it, which
+// costs up to one extra permutation per block for about
+// KPOW_MUL/K * sizeof(Keccak_HashInstance) + K * KRATE bytes of memory.
+// KSHAKE320v2CheckpointedFinish is the second pass from the first-pass
+// sponge h1 once finalized.
+template<int K>
+inline uint320 KSHAKE320v2CheckpointedFinish(Keccak_HashInstance &h1)
+{
+    const int segments = (KPOW_MUL + K - 1) / K;
+    const int lastSegmentBlocks = KPOW_MUL - (segments - 1) * K;
+    Keccak_HashInstance checkpoints[segments];
+    unsigned char segment[K * KRATE];
+
+    for (int i = 0; i < segments - 1; i++)
+    {
+        checkpoints[i] = h1;
+        Keccak_HashSqueeze(&h1, segment, K * KRATE * 8);
+    }
+    Keccak_HashSqueeze(&h1, segment, lastSegmentBlocks * KRATE * 8);
+    KSHAKE320_PERF_LAP(KSHAKE320_PHASE_V2_SQUEEZE, 1);
+
+    Keccak_HashInstance h2;
+    Keccak_HashInitialize(&h2, SHAKE320_R, SHAKE320_C, 0, SHAKE320_P);
+    SHAKE320AbsorbReversed(&h2, segment, lastSegmentBlocks);
+    for (int i = segments - 2; i >= 0; i--)
+    {
+        Keccak_HashSqueeze(&checkpoints[i], segment, K * KRATE * 8);
+        SHAKE320AbsorbReversed(&h2, segment, K);
+    }
+    KSHAKE320_PERF_LAP(KSHAKE320_PHASE_V2_REVERSED_ABSORB, 1);
+
+    uint320 hash;
+    Keccak_HashFinal(&h2, NULL);
+    Keccak_HashSqueeze(&h2, (unsigned char*)&hash, SHAKE320_L);
+    KSHAKE320_PERF_LAP(KSHAKE320_PHASE_V2_FINAL_SQUEEZE, 1);
+    return hash;
+}
+
+template<int K, typename T1>
+inline uint320 KSHAKE320v2Checkpointed(const T1 pbegin, const T1 pend)
+{
+    static const unsigned char pblank[1] = { 0 };
+    KSHAKE320_PERF_START();
+    Keccak_HashInstance h1;
+    Keccak_HashInitialize(&h1, SHAKE320_R, SHAKE320_C, 0, SHAKE320_P);
+    Keccak_HashUpdate(&h1, (pbegin == pend ? pblank : (const unsigned char*)&pbegin[0]), (pend - pbegin) * sizeof(pbegin[0]) * 8);
+    Keccak_HashFinal(&h1, NULL);
+    KSHAKE320_PERF_LAP(KSHAKE320_PHASE_V2_ABSORB, 1);
+    return KSHAKE320v2CheckpointedFinish<K>(h1);
+}
+
+template<typename T1>
+inline uint320 Hash320(const T1 pbegin, const T1 pend)
+{
+    static const unsigned char pblank[1] = { 0 };
+    uint320 hash;
+    SHAKE320((pbegin == pend ? pblank : (const unsigned char*)&pbegin[0]), (pend - pbegin) * sizeof(pbegin[0]) * 8, (unsigned char*)&hash, sizeof(hash));
+    return hash;
+}
+
+template<typename T1>
+inline uint256 Hash256(const T1 pbegin, const T1 pend)
+{
+    static const unsigned char pblank[1] = { 0 };
+    uint256 hash1;
+    SHA3_256((pbegin == pend ? pblank : (const unsigned char*)&pbegin[0]), (pend - pbegin) * sizeof(pbegin[0]), (unsigned char*)&hash1);
+    uint256 hash2;
+    SHA3_256((unsigned char*)&hash1, sizeof(hash1), (unsigned char*)&hash2);
+    return hash2;
+}
+
+// scratchpad must hold KPROOF_OF_WORK_SZ bytes; only v2 headers use it.
+void KSHAKE320POW(const char *input, char *output, unsigned char *scratchpad)
+{
+    uint320 hash;
+    int version = *((int *)input);
+
+    if (version <= 1) {
+        hash = KryptoHash(input, input + 120);
+    }
+    else {
+#if KSHAKE320_V2_CHECKPOINT_INTERVAL > 0
+        (void)scratchpad;
+        hash = KSHAKE320v2Checkpointed<KSHAKE320_V2_CHECKPOINT_INTERVAL>(input, input + 120);
+#else
+        hash = KSHAKE320v2(input, input + 120, scratchpad);
+#endif
+    }
+    memcpy(output, &hash, 40);
+}
+
+void KSHAKE320POW(const char *input, char *output)
+{
+    uint320 hash;
+    int version = *((int *)input);
+
+    if (version <= 1) {
+        hash = KryptoHash(input, input + 120);
+    }
+    else {
+#if KSHAKE320_V2_CHECKPOINT_INTERVAL > 0
+        hash = KSHAKE320v2Checkpointed<KSHAKE320_V2_CHECKPOINT_INTERVAL>(input, input + 120);
+#else
+        hash = KSHAKE320v2(input, input + 120);
+#endif
+    }
+    memcpy(output, &hash, 40);
+}
+
+int KSHAKE320Initialize()
+{
+    static std::once_flag once;
+    static int failed = 0;
+    std::call_once(once, [] {
+#ifdef USE_KECCAK_DISPATCH
+        failed = KeccakF1600_DispatchInitialize();
+#endif
+        failed |= Sha256_DispatchInitialize();
+    });
+    return failed;
+}
+
+const char *KSHAKE320Backend()
+{
+#ifdef USE_KECCAK_DISPATCH
+    return KeccakF1600_ActiveBackend->name;
+#else
+    return "scalar";
+#endif
+}
+
+unsigned int KSHAKE320Parallelism()
+{
+#ifdef USE_KECCAK_DISPATCH
+    return KeccakF1600_ActiveBackend->parallelism;
+#else
+    return 1;
+#endif
+}
+
+KSHAKE320Midstate::KSHAKE320Midstate(const char *header, unsigned int nonceOffset)
+    : nNonceOffset(nonceOffset), fV2(*((int *)header) > 1)
+{
+    Keccak_HashInitialize(&prefix, SHAKE320_R, SHAKE320_C, 0, SHAKE320_P);
+    Keccak_HashUpdate(&prefix, (const unsigned char *)header, nonceOffset * 8);
+    memcpy(tail, header + nonceOffset, 120 - nonceOffset);
+    memcpy(version, header, 4);
+}
+
+bool KSHAKE320Midstate::V2(uint32_t nonce) const
+{
+    if (nNonceOffset >= 4)
+        return fV2;
+    char bytes[8];
+    memcpy(bytes, version, 4);
+    KSHAKE320SetNonce(bytes, nNonceOffset, nonce);
+    int nVersion;
+    memcpy(&nVersion, bytes, 4);
+    return nVersion > 1;
+}
+
+uint64_t KSHAKE320Midstate::CountV2(uint64_t start, uint64_t count) const
+{
+    if (nNonceOffset >= 4)
+        return fV2 ? count : 0;
+    uint64_t v2 = 0;
+    for (uint64_t n = start; n < start + count; n++)
+        v2 += V2((uint32_t)n);
+    return v2;
+}
+
+void KSHAKE320Midstate::Hash(uint32_t nonce, char *output, unsigned char *scratchpad) const
+{
+    KSHAKE320_PERF_START();
+    const bool v2 = V2(nonce);
+    Keccak_HashInstance h = prefix;
+    char work[120];
+    memcpy(work, tail, 120 - nNonceOffset);
+    KSHAKE320SetNonce(work, 0, nonce);
+    Keccak_HashUpdate(&h, (const unsigned char *)work, (120 - nNonceOffset) * 8);
+    Keccak_HashFinal(&h, NULL);
+    KSHAKE320_PERF_LAP(v2 ? KSHAKE320_PHASE_V2_ABSORB : KSHAKE320_PHASE_V1_ABSORB, 1);
+
+    uint320 hash;
+    if (!v2) {
+        hash = KryptoHashFinish(h);
+    }
+    else {
+#if KSHAKE320_V2_CHECKPOINT_INTERVAL > 0
+        (void)scratchpad;
+        hash = KSHAKE320v2CheckpointedFinish<KSHAKE320_V2_CHECKPOINT_INTERVAL>(h);
+#else
+        hash = KSHAKE320v2Finish(h, scratchpad);
+#endif
+    }
+    memcpy(output, &hash, 40);
+}
+
+void KSHAKE320Midstate::Hash(uint32_t nonce, char *output) const
+{
+    if (!V2(nonce) || KSHAKE320_V2_CHECKPOINT_INTERVAL > 0) {
+        Hash(nonce, output, NULL);
+        return;
+    }
+    std::vector<unsigned char> scratchpad(KPROOF_OF_WORK_SZ);
+    Hash(nonce, output, &scratchpad[0]);
+}
+
+// Hashes the header template for every nonce in [start, start + count), with
+// start + count at most 2**32, and collects the nonces whose PoW hash does not
+// exceed target.
+void KSHAKE320Scan(const KSHAKE320Midstate &midstate, uint64_t start, uint64_t count,
+                    const uint320 &target, std::vector<std::pair<uint32_t, uint320> > &found)
+{
+    std::vector<unsigned char> scratchpad(midstate.AnyV2() ? KPROOF_OF_WORK_SZ : 0);
+
+    for (uint64_t n = start; n < start + count; n++) {
+        uint320 hash;
+        midstate.Hash((uint32_t)n, (char *)hash.begin(), scratchpad.data());
+        if (hash <= target)
+            found.push_back(std::make_pair((uint32_t)n, hash));
+    }
+}
+
+#ifdef USE_KECCAK_DISPATCH
+// Binds the parallel sponges to one interface for KSHAKE320POWParallel.
+struct KSHAKE320Times4
+{
+    enum { parallelism = 4 };
+    typedef KeccakTimes4_SpongeInstance Instance;
+    static void Initialize(Instance *instance) { KeccakTimes4_SpongeInitialize(instance, SHAKE320_R, SHAKE320_C); }
+    static void Absorb(Instance *instance, const unsigned char *data, size_t instanceStride, size_t len) { KeccakTimes4_SpongeAbsorb(instance, data, instanceStride, len); }
+    static void Final(Instance *instance) { KeccakTimes4_SpongeAbsorbLastFewBits(instance, SHAKE320_P); }
+    static void Squeeze(Instance *instance, unsigned char *data, size_t instanceStride, size_t len) { KeccakTimes4_SpongeSqueeze(instance, data, instanceStride, len); }
+};
+
+struct KSHAKE320Times8
+{
+    enum { parallelism = 8 };
+    typedef KeccakTimes8_SpongeInstance Instance;
+    static void Initialize(Instance *instance) { KeccakTimes8_SpongeInitialize(instance, SHAKE320_R, SHAKE320_C); }
+    static void Absorb(Instance *instance, const unsigned char *data, size_t instanceStride, size_t len) { KeccakTimes8_SpongeAbsorb(instance, data, instanceStride, len); }
+    static void Final(Instance *instance) { KeccakTimes8_SpongeAbsorbLastFewBits(instance, SHAKE320_P); }
+    static void Squeeze(Instance *instance, unsigned char *data, size_t instanceStride, size_t len) { KeccakTimes8_SpongeSqueeze(instance, data, instanceStride, len); }
+};
+
+// KSHAKE320POW of P::parallelism headers of the same version at once.
+// headers and outputs are contiguous arrays of 120-byte headers and 40-byte
+// hashes. v1 passes each block from the first sponges to the second ones
+// through a buffer of one block per instance; v2 needs a scratchpad of
+// P::parallelism * KPROOF_OF_WORK_SZ bytes.
+template<class P>
+static void KSHAKE320POWParallel(const unsigned char *headers, unsigned char *outputs, bool v2, unsigned char *scratchpad)
+{
+    typename P::Instance first, second;
+
+    KSHAKE320_PERF_START();
+    P::Initialize(&first);
+    P::Absorb(&first, headers, 120, 120);
+    P::Final(&first);
+    KSHAKE320_PERF_LAP(v2 ? KSHAKE320_PHASE_V2_ABSORB : KSHAKE320_PHASE_V1_ABSORB, P::parallelism);
+    P::Initialize(&second);
+    if (!v2) {
+        unsigned char blocks[P::parallelism * KRATE];
+        for (int i = 0; i < KPOW_MUL; i++) {
+            P::Squeeze(&first, blocks, KRATE, KRATE);
+            P::Absorb(&second, blocks, KRATE, KRATE);
+        }
+        KSHAKE320_PERF_LAP(KSHAKE320_PHASE_V1_SQUEEZE_ABSORB, P::parallelism);
+    }
+    else {
+        P::Squeeze(&first, scratchpad, KPROOF_OF_WORK_SZ, KPROOF_OF_WORK_SZ);
+        KSHAKE320_PERF_LAP(KSHAKE320_PHASE_V2_SQUEEZE, P::parallelism);
+        for (int i = KPOW_MUL - 1; i >= 0; i--)
+            P::Absorb(&second, scratchpad + i * KRATE, KPROOF_OF_WORK_SZ, KRATE);
+        KSHAKE320_PERF_LAP(KSHAKE320_PHASE_V2_REVERSED_ABSORB, P::parallelism);
+    }
+    P::Final(&second);
+    P::Squeeze(&second, outputs, 40, 40);
+    KSHAKE320_PERF_LAP(v2 ? KSHAKE320_PHASE_V2_FINAL_SQUEEZE : KSHAKE320_PHASE_V1_FINAL_SQUEEZE, P::parallelism);
+}
+
+// Runs the headers of one version, given by their indexes, through the
+// parallel kernel. The last group is completed with copies of its last header.
+template<class P>
+static void KSHAKE320POWGroups(const char *headers, const std::vector<size_t> &indexes, bool v2, char *outputs, unsigned char *scratchpad)
+{
+    unsigned char group[P::parallelism * 120];
+    unsigned char hashes[P::parallelism * 40];
+
+    for (size_t i = 0; i < indexes.size(); i += P::parallelism) {
+        size_t n = std::min((size_t)P::parallelism, indexes.size() - i);
+        for (size_t j = 0; j < (size_t)P::parallelism; j++)
+            memcpy(group + j * 120, headers + indexes[i + std::min(j, n - 1)] * 120, 120);
+        KSHAKE320POWParallel<P>(group, hashes, v2, scratchpad);
+        for (size_t j = 0; j < n; j++)
+            memcpy(outputs + indexes[i + j] * 40, hashes + j * 40, 40);
+    }
+}
+
+template<class P>
+static void KSHAKE320POWBatchParallel(const char *headers, size_t count, char *outputs)
+{
+    std::vector<size_t> v1, v2;
+    for (size_t i = 0; i < count; i++) {
+        int version;
+        memcpy(&version, headers + i * 120, sizeof(version));
+        (version <= 1 ? v1 : v2).push_back(i);
+    }
+    KSHAKE320POWGroups<P>(headers, v1, false, outputs, NULL);
+#if KSHAKE320_V2_CHECKPOINT_INTERVAL > 0
+    // The parallel v2 kernel needs full scratchpads, which this build avoids
+    for (size_t i = 0; i < v2.size(); i++)
+        KSHAKE320POW(headers + v2[i] * 120, outputs + v2[i] * 40);
+#else
+    if (!v2.empty()) {
+        std::vector<unsigned char> scratchpad((size_t)P::parallelism * KPROOF_OF_WORK_SZ);
+        KSHAKE320POWGroups<P>(headers, v2, true, outputs, &scratchpad[0]);
+    }
+#endif
+}
+#endif
+
+void KSHAKE320POWBatch(const char *headers, size_t count, char *outputs)
+{
+#ifdef USE_KECCAK_DISPATCH
+    if (KeccakF1600_ActiveBackend->parallelism == 8) {
+        KSHAKE320POWBatchParallel<KSHAKE320Times8>(headers, count, outputs);
+        return;
+    }
+    if (KeccakF1600_ActiveBackend->parallelism == 4) {
+        KSHAKE320POWBatchParallel<KSHAKE320Times4>(headers, count, outputs);
+        return;
+    }
+#endif
+    std::vector<unsigned char> scratchpad(KPROOF_OF_WORK_SZ);
+    for (size_t i = 0; i < count; i++)
+        KSHAKE320POW(headers + i * 120, outputs + i * 40, &scratchpad[0]);
+}
+
+// The headers are split in contiguous ranges, multiples of the widest SIMD
+// group, so that only the last group of each version is padded.
+void KSHAKE320POWBatchThreaded(const char *headers, size_t count, char *outputs, unsigned int threads)
+{
+    const size_t group = 8;
+    size_t perThread = ((count + threads - 1) / threads + group - 1) / group * group;
+    std::atomic<bool> failed(false);
+    auto run = [&](size_t begin, size_t end) {
+        try {
+            KSHAKE320POWBatch(headers + begin * 120, end - begin, outputs + begin * 40);
+        }
+        catch (const std::bad_alloc &) {
+            failed = true;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    size_t next = std::min(perThread, count);
+    try {
+        for (; next < count; next += perThread)
+            workers.push_back(std::thread(run, next, std::min(next + perThread, count)));
+    }
+    catch (const std::system_error &) {
+        // Out of threads: the ranges left are hashed by this one
+    }
+    run(0, std::min(perThread, count));
+    if (next < count)
+        run(next, count);
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+    if (failed)
+        throw std::bad_alloc();
+}
+
+void GetHash320(const char *input, size_t len, char *output)
+{
+    uint320 hash = Hash320(input, input + len);
+    memcpy(output, &hash, 40);
+}
+
+void GetHash256(const char *input, size_t len, char *output)
+{
+    uint256 hash = Hash256(input, input + len);
+    memcpy(output, &hash, 32);
+}
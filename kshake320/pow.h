@@ -0,0 +1,102 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef KSHAKE320_POW_H
+#define KSHAKE320_POW_H
+
+// C++ interface of the kshake320 hashing core, which kshake320.h wraps for C.
+// Nothing here depends on Python.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <utility>
+#include <vector>
+
+#include "../keccak/KeccakHash.h"
+#include "../keccak/sha3.h"
+#include "../keccak/uint256.h"
+
+#define SHAKE320_L         (320)  // Length in bits
+#define KPOW_MUL           (546)  // How many Keccak blocks the PoW contains
+#define KRATE              (SHAKE320_R / 8)  // Keccak rate in bytes
+#define KPROOF_OF_WORK_SZ  (KRATE * KPOW_MUL)  // KryptoHash PoW Size in bytes. It must be a multiple of Keccak Rate.
+
+// Selects the Keccak backend and the SHA-256 implementation, once per process
+// whoever calls it. Returns nonzero if the environment forces one the CPU
+// cannot run, in which case the detected one is used.
+int KSHAKE320Initialize();
+
+// Name of the Keccak backend in use: "scalar", "avx2" or "avx512".
+const char *KSHAKE320Backend();
+
+// Number of headers the parallel kernel of the backend hashes at once, 1
+// when it has none.
+unsigned int KSHAKE320Parallelism();
+
+// PoW hash of a 120-byte header into 40 bytes. scratchpad must hold
+// KPROOF_OF_WORK_SZ bytes; only v2 headers use it.
+void KSHAKE320POW(const char *input, char *output, unsigned char *scratchpad);
+void KSHAKE320POW(const char *input, char *output);
+
+// KSHAKE320POW of count contiguous 120-byte headers into count 40-byte hashes,
+// using the parallel kernel of the active backend if it has one. Throws
+// std::bad_alloc.
+void KSHAKE320POWBatch(const char *headers, size_t count, char *outputs);
+
+// KSHAKE320POWBatch with the headers split between threads, the calling one
+// included. Throws std::bad_alloc.
+void KSHAKE320POWBatchThreaded(const char *headers, size_t count, char *outputs, unsigned int threads);
+
+// SHAKE320 of len bytes into 40 bytes, and the 32-byte hash 256.
+void GetHash320(const char *input, size_t len, char *output);
+void GetHash256(const char *input, size_t len, char *output);
+
+static inline void KSHAKE320SetNonce(char *header, unsigned int nonceOffset, uint32_t nonce)
+{
+    header[nonceOffset]     = (char)(nonce);
+    header[nonceOffset + 1] = (char)(nonce >> 8);
+    header[nonceOffset + 2] = (char)(nonce >> 16);
+    header[nonceOffset + 3] = (char)(nonce >> 24);
+}
+
+// 120-byte header template of a mining job, hashed for one nonce at a time.
+// The version is read once and the bytes before the nonce are absorbed once
+// into a sponge that is copied for every nonce, which then only absorbs the
+// nonce and the bytes after it before the two passes of the PoW. A nonce
+// written over the version, before offset 4, sets the version of each header.
+class KSHAKE320Midstate
+{
+public:
+    KSHAKE320Midstate(const char *header, unsigned int nonceOffset);
+
+    unsigned int NonceOffset() const { return nNonceOffset; }
+    // Whether the template, as given, is a v2 header.
+    bool V2() const { return fV2; }
+    // Whether the header with the nonce is a v2 header.
+    bool V2(uint32_t nonce) const;
+    // Whether some nonce gives a v2 header.
+    bool AnyV2() const { return fV2 || nNonceOffset < 4; }
+    // Number of the nonces in [start, start + count) that give v2 headers.
+    uint64_t CountV2(uint64_t start, uint64_t count) const;
+
+    // scratchpad must hold KPROOF_OF_WORK_SZ bytes; only v2 headers use it.
+    void Hash(uint32_t nonce, char *output, unsigned char *scratchpad) const;
+    void Hash(uint32_t nonce, char *output) const;
+
+private:
+    Keccak_HashInstance prefix;
+    char tail[120];
+    char version[4];
+    const unsigned int nNonceOffset;
+    const bool fV2;
+};
+
+// Hashes the header template for every nonce in [start, start + count), with
+// start + count at most 2**32, and collects the nonces whose PoW hash does not
+// exceed target.
+void KSHAKE320Scan(const KSHAKE320Midstate &midstate, uint64_t start, uint64_t count,
+                   const uint320 &target, std::vector<std::pair<uint32_t, uint320> > &found);
+
+#endif
@@ -0,0 +1,257 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef KSHAKE320_SEARCHER_H
+#define KSHAKE320_SEARCHER_H
+
+#include "metrics.h"
+#include "pow.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+// Nonce search on a persistent pool of threads.
+// A job splits its nonce range evenly between the workers. Each worker takes
+// chunks from the front of its own share and, once it is used up, steals
+// chunks from the shares of the others, so that the job ends when the slowest
+// chunk does. Jobs run one at a time: submitting a job stops the running one,
+// and so does the first solution of a job submitted with stopOnFirst.
+// Every worker owns a scratchpad allocated when the pool starts, and counts
+// the headers it hashes in the metrics of its thread.
+// The pool may be destroyed from onDone: the worker calling it is then
+// detached instead of joined, and leaves without touching the pool again.
+class KSHAKE320Searcher
+{
+public:
+    enum Status { RUNNING, EXHAUSTED, SOLVED, CANCELLED };
+
+    struct Job
+    {
+        struct Share
+        {
+            std::atomic<uint64_t> next;
+            uint64_t end;
+        };
+
+        Job() : midstate(nullptr) {}
+        ~Job()
+        {
+            if (midstate != nullptr)
+                midstate->~KSHAKE320Midstate();
+        }
+
+        // Built in storage aligned as its sponge wants it
+        KSHAKE320Midstate *midstate;
+        char midstateStorage[sizeof(KSHAKE320Midstate) + 32];
+        uint320 target;
+        bool stopOnFirst;
+        // Called once the job has ended, from the worker that ended it.
+        std::function<void(Job &)> onDone;
+
+        std::unique_ptr<Share[]> shares;
+        std::atomic<bool> stop;
+        std::atomic<bool> cancelled;
+        std::atomic<unsigned int> running;
+        // Nonces hashed by all the workers, once the job has ended
+        std::atomic<uint64_t> hashed;
+        std::mutex resultsMutex;
+        // Sorted by nonce once the job has ended
+        std::vector<std::pair<uint32_t, uint320> > results;
+        Status status;
+    };
+
+    KSHAKE320Searcher(unsigned int threads, unsigned int chunkSize)
+        : nThreads(threads), nChunkSize(chunkSize), generation(0), shutdown(false)
+    {
+        for (unsigned int i = 0; i < nThreads; i++)
+            workers.push_back(std::thread(&KSHAKE320Searcher::WorkerMain, this, i));
+    }
+
+    ~KSHAKE320Searcher()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            WaitIdle(lock);
+            shutdown = true;
+        }
+        workCv.notify_all();
+        for (size_t i = 0; i < workers.size(); i++) {
+            if (workers[i].get_id() == std::this_thread::get_id()) {
+                CurrentPool() = nullptr;
+                workers[i].detach();
+            }
+            else
+                workers[i].join();
+        }
+    }
+
+    unsigned int Threads() const { return nThreads; }
+
+    // Starts a search over the nonces [start, start + count), once the
+    // running job, which is cancelled, has ended.
+    std::shared_ptr<Job> Submit(const char *header, unsigned int nonceOffset, uint64_t start, uint64_t count,
+                                const uint320 &target, bool stopOnFirst, std::function<void(Job &)> onDone)
+    {
+        std::shared_ptr<Job> job(new Job);
+        void *storage = (void *)(((uintptr_t)job->midstateStorage + 31) & ~(uintptr_t)31);
+        job->midstate = new (storage) KSHAKE320Midstate(header, nonceOffset);
+        job->target = target;
+        job->stopOnFirst = stopOnFirst;
+        job->onDone = onDone;
+        job->shares.reset(new Job::Share[nThreads]);
+        for (unsigned int i = 0; i < nThreads; i++) {
+            job->shares[i].next = start + count * i / nThreads;
+            job->shares[i].end = start + count * (i + 1) / nThreads;
+        }
+        job->stop = false;
+        job->cancelled = false;
+        job->running = nThreads;
+        job->hashed = 0;
+        job->status = RUNNING;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            WaitIdle(lock);
+            current = job;
+            generation++;
+        }
+        workCv.notify_all();
+        return job;
+    }
+
+    void Cancel()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (current && current->status == RUNNING) {
+            current->cancelled = true;
+            current->stop = true;
+        }
+    }
+
+    // Blocks until the job has ended. Must not be called from onDone.
+    void Wait(const std::shared_ptr<Job> &job)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        doneCv.wait(lock, [&job] { return job->status != RUNNING; });
+    }
+
+    void WaitCurrent()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        std::shared_ptr<Job> job = current;
+        if (job)
+            doneCv.wait(lock, [&job] { return job->status != RUNNING; });
+    }
+
+private:
+    // Pool of the calling worker, reset when onDone destroys it.
+    static KSHAKE320Searcher *&CurrentPool()
+    {
+        static thread_local KSHAKE320Searcher *pool = nullptr;
+        return pool;
+    }
+
+    // Cancels the running job, if any, and waits until it has ended.
+    void WaitIdle(std::unique_lock<std::mutex> &lock)
+    {
+        while (current && current->status == RUNNING) {
+            current->cancelled = true;
+            current->stop = true;
+            doneCv.wait(lock);
+        }
+    }
+
+    void WorkerMain(unsigned int index)
+    {
+        std::vector<unsigned char> scratchpad(KPROOF_OF_WORK_SZ);
+        uint64_t seen = 0;
+
+        CurrentPool() = this;
+
+        for (;;) {
+            std::shared_ptr<Job> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                workCv.wait(lock, [this, seen] { return shutdown || generation != seen; });
+                if (shutdown)
+                    return;
+                seen = generation;
+                job = current;
+            }
+            uint64_t hashes[2] = { 0, 0 };
+            Work(*job, index, &scratchpad[0], hashes);
+            KSHAKE320Metrics::RecordPoW(false, hashes[0]);
+            KSHAKE320Metrics::RecordPoW(true, hashes[1]);
+            job->hashed += hashes[0] + hashes[1];
+            if (job->running.fetch_sub(1) == 1) {
+                Finish(*job);
+                if (CurrentPool() == nullptr)
+                    return;
+            }
+        }
+    }
+
+    // Adds the v1 and v2 headers hashed to hashes.
+    void Work(Job &job, unsigned int index, unsigned char *scratchpad, uint64_t hashes[2])
+    {
+        // Own share first, then the others'
+        for (unsigned int k = 0; k < nThreads; k++) {
+            Job::Share &share = job.shares[(index + k) % nThreads];
+            for (;;) {
+                uint64_t begin = share.next.fetch_add(nChunkSize);
+                if (begin >= share.end)
+                    break;
+                uint64_t end = std::min(begin + nChunkSize, share.end);
+                for (uint64_t n = begin; n < end; n++) {
+                    if (job.stop.load(std::memory_order_relaxed))
+                        return;
+                    uint320 hash;
+                    job.midstate->Hash((uint32_t)n, (char *)hash.begin(), scratchpad);
+                    hashes[job.midstate->V2((uint32_t)n) ? 1 : 0]++;
+                    if (hash <= job.target) {
+                        std::lock_guard<std::mutex> lock(job.resultsMutex);
+                        job.results.push_back(std::make_pair((uint32_t)n, hash));
+                        if (job.stopOnFirst)
+                            job.stop = true;
+                    }
+                }
+            }
+        }
+    }
+
+    void Finish(Job &job)
+    {
+        std::sort(job.results.begin(), job.results.end(),
+                  [](const std::pair<uint32_t, uint320> &a, const std::pair<uint32_t, uint320> &b) { return a.first < b.first; });
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (job.cancelled)
+                job.status = CANCELLED;
+            else
+                job.status = job.results.empty() ? EXHAUSTED : SOLVED;
+        }
+        doneCv.notify_all();
+        if (job.onDone)
+            job.onDone(job);
+    }
+
+    const unsigned int nThreads;
+    const unsigned int nChunkSize;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable workCv;
+    std::condition_variable doneCv;
+    std::shared_ptr<Job> current;
+    uint64_t generation;
+    bool shutdown;
+};
+
+#endif
@@ -0,0 +1,194 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef KSHAKE320_VERIFYPOOL_H
+#define KSHAKE320_VERIFYPOOL_H
+
+// The pool signals completions on a file descriptor, which needs POSIX.
+#ifndef _WIN32
+#define KSHAKE320_HAVE_VERIFYPOOL 1
+
+#include "metrics.h"
+#include "pow.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+// Pool of threads hashing the headers queued by Submit, several at a time.
+// A worker takes up to four times the number of states of the parallel
+// kernel from the queue, so that the headers of each version fill whole SIMD
+// groups when requests come in faster than they are hashed. Finished hashes
+// wait in a completion queue, whose file descriptor becomes readable when it
+// goes from empty to not empty: an event loop watches it and calls Take.
+// Workers count the headers they hash in the metrics of their threads.
+class KSHAKE320VerifyPool
+{
+public:
+    struct Completion
+    {
+        uint64_t id;
+        uint320 hash;
+    };
+
+    explicit KSHAKE320VerifyPool(unsigned int threads)
+        : nThreads(threads), shutdown(false)
+    {
+        nBatch = 4 * KSHAKE320Parallelism();
+#ifdef __linux__
+        readFd = writeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (readFd < 0)
+            throw std::runtime_error("eventfd failed");
+#else
+        int fds[2];
+        if (pipe(fds) != 0)
+            throw std::runtime_error("pipe failed");
+        for (int i = 0; i < 2; i++) {
+            fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+            fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+        }
+        readFd = fds[0];
+        writeFd = fds[1];
+#endif
+        for (unsigned int i = 0; i < nThreads; i++)
+            workers.push_back(std::thread(&KSHAKE320VerifyPool::WorkerMain, this));
+    }
+
+    // Stops the workers once their batches are done, dropping the requests
+    // still queued.
+    ~KSHAKE320VerifyPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            shutdown = true;
+        }
+        workCv.notify_all();
+        for (size_t i = 0; i < workers.size(); i++)
+            workers[i].join();
+        close(readFd);
+        if (writeFd != readFd)
+            close(writeFd);
+    }
+
+    unsigned int Threads() const { return nThreads; }
+    int Fd() const { return readFd; }
+
+    void Submit(uint64_t id, const char *header)
+    {
+        Request request;
+        request.id = id;
+        memcpy(request.header, header, sizeof(request.header));
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            requests.push_back(request);
+        }
+        workCv.notify_one();
+    }
+
+    // Moves the finished hashes to completions and resets the file descriptor.
+    void Take(std::vector<Completion> &completions)
+    {
+        char buf[64];
+        while (read(readFd, buf, writeFd == readFd ? 8 : sizeof(buf)) > 0)
+            ;
+        std::lock_guard<std::mutex> lock(doneMutex);
+        completions.swap(done);
+        done.clear();
+    }
+
+    // Puts back completions taken but not handled, for the next Take.
+    void Restore(const std::vector<Completion> &completions)
+    {
+        if (completions.empty())
+            return;
+        bool wake;
+        {
+            std::lock_guard<std::mutex> lock(doneMutex);
+            wake = done.empty();
+            done.insert(done.begin(), completions.begin(), completions.end());
+        }
+        if (wake)
+            Signal();
+    }
+
+private:
+    struct Request
+    {
+        uint64_t id;
+        char header[120];
+    };
+
+    void WorkerMain()
+    {
+        std::vector<Request> batch;
+        std::vector<char> headers, hashes;
+        std::vector<Completion> results;
+
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                workCv.wait(lock, [this] { return shutdown || !requests.empty(); });
+                if (shutdown)
+                    return;
+                size_t n = std::min(requests.size(), nBatch);
+                batch.assign(requests.begin(), requests.begin() + n);
+                requests.erase(requests.begin(), requests.begin() + n);
+                if (!requests.empty())
+                    workCv.notify_one();
+            }
+
+            headers.resize(batch.size() * 120);
+            hashes.resize(batch.size() * 40);
+            for (size_t i = 0; i < batch.size(); i++)
+                memcpy(&headers[i * 120], batch[i].header, 120);
+            KSHAKE320POWBatch(&headers[0], batch.size(), &hashes[0]);
+            KSHAKE320Metrics::RecordPoWHeaders(&headers[0], batch.size());
+
+            results.resize(batch.size());
+            for (size_t i = 0; i < batch.size(); i++) {
+                results[i].id = batch[i].id;
+                memcpy(results[i].hash.begin(), &hashes[i * 40], 40);
+            }
+            bool wake;
+            {
+                std::lock_guard<std::mutex> lock(doneMutex);
+                wake = done.empty();
+                done.insert(done.end(), results.begin(), results.end());
+            }
+            if (wake)
+                Signal();
+        }
+    }
+
+    // Makes the file descriptor readable.
+    void Signal()
+    {
+        uint64_t one = 1;
+        ssize_t written = write(writeFd, &one, writeFd == readFd ? 8 : 1);
+        (void)written;  // A full pipe is already readable
+    }
+
+    const unsigned int nThreads;
+    size_t nBatch;
+    int readFd, writeFd;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable workCv;
+    std::deque<Request> requests;
+    bool shutdown;
+    std::mutex doneMutex;
+    std::vector<Completion> done;
+};
+#endif
+
+#endif
@@ -1,207 +1,1816 @@
+#define PY_SSIZE_T_CLEAN
 #include <Python.h>
+#include <pythread.h>
 
-#include "keccak/uint256.h"
-
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <thread>
 #include <vector>
-#include <openssl/ripemd.h>
-#include <openssl/sha.h>
 #include "keccak/sha3.h"
+#include "kshake320/kshake320.h"
+#include "kshake320/metrics.h"
+#include "kshake320/perf.h"
+#include "kshake320/pow.h"
+#include "kshake320/searcher.h"
+#include "kshake320/verifypool.h"
+
+// AsyncPoW needs asyncio and the file descriptor of a KSHAKE320VerifyPool.
+#if PY_MAJOR_VERSION >= 3 && defined(KSHAKE320_HAVE_VERIFYPOOL)
+#define KSHAKE320_ASYNC 1
+#else
+#define KSHAKE320_ASYNC 0
+#endif
 
-#define SHAKE320_L         (320)  // Length in bits
-#define KPOW_MUL           (546)  // How many Keccak blocks the PoW contains
-#define KRATE              (SHAKE320_R / 8)  // Keccak rate in bytes
-#define KPROOF_OF_WORK_SZ  (KRATE * KPOW_MUL)  // KryptoHash PoW Size in bytes. It must be a multiple of Keccak Rate.
+#if PY_MAJOR_VERSION >= 3
+#define KSHAKE320_BUFFER "y*"
+#else
+#define KSHAKE320_BUFFER "s*"
+#endif
 
-template<typename T1>
-inline uint320 KryptoHash(const T1 pbegin, const T1 pend)
+// Returns a new reference to the object holding a result of size bytes:
+// the writable buffer out, exported into view, if given, else a new bytes
+// object. *data is where the result must be written.
+static PyObject *kshake320_openoutput(PyObject *out, Py_ssize_t size, Py_buffer *view, char **data)
 {
-    static unsigned char pblank[1] = { 0 };
-    unsigned char scratchpad[KPROOF_OF_WORK_SZ];
-    SHAKE320((pbegin == pend ? pblank : (unsigned char*)&pbegin[0]), (pend - pbegin) * sizeof(pbegin[0]) * 8, scratchpad, sizeof(scratchpad));
-    uint320 hash;
-    SHAKE320(scratchpad, sizeof(scratchpad) * 8, (unsigned char*)&hash, SHAKE320_L / 8);
-    return hash;
+    view->obj = NULL;
+    if (out == NULL || out == Py_None) {
+        PyObject *value = PyBytes_FromStringAndSize(NULL, size);
+        if (value != NULL)
+            *data = PyBytes_AS_STRING(value);
+        return value;
+    }
+    if (PyObject_GetBuffer(out, view, PyBUF_WRITABLE) < 0)
+        return NULL;
+    if (view->len < size) {
+        PyBuffer_Release(view);
+        PyErr_Format(PyExc_ValueError, "out must be at least %zd bytes long", size);
+        return NULL;
+    }
+    *data = (char *)view->buf;
+    Py_INCREF(out);
+    return out;
 }
 
-template<typename T1>
-inline uint320 KSHAKE320v2(const T1 pbegin, const T1 pend)
+static void kshake320_closeoutput(Py_buffer *view)
 {
-    static unsigned char pblank[1] = { 0 };
-    unsigned char scratchpad1[KPROOF_OF_WORK_SZ];
-    unsigned char scratchpad2[KPROOF_OF_WORK_SZ];
-    SHAKE320((pbegin == pend ? pblank : (unsigned char*)&pbegin[0]), (pend - pbegin) * sizeof(pbegin[0]) * 8, scratchpad1, sizeof(scratchpad1));
+    if (view->obj != NULL)
+        PyBuffer_Release(view);
+}
 
-    // Swap blocks in chunks of KRATE size
-    unsigned char *p1 = scratchpad1 + KPROOF_OF_WORK_SZ;
-    unsigned char *p2 = scratchpad2;
-    for (int i = 0; i < KPOW_MUL; i++)
-    {
-        p1 -= KRATE;
-        memcpy(p2, p1, KRATE);
-        p2 += KRATE;
-    }
+// Inputs shorter than this are hashed without releasing the GIL, which
+// would cost more than it saves, as hashlib does.
+#define KSHAKE320_GIL_MINSIZE 2048
+
+enum { KSHAKE320_POW, KSHAKE320_HASH320, KSHAKE320_HASH256, KSHAKE320_SHA256D, KSHAKE320_HASH160 };
 
-    uint320 hash;
-    SHAKE320(scratchpad2, sizeof(scratchpad2) * 8, (unsigned char*)&hash, SHAKE320_L / 8);
-    return hash;
+// Counts the headers of the nonces [start, start + count) of a midstate.
+static void kshake320_recordscan(const KSHAKE320Midstate &midstate, uint64_t start, uint64_t count)
+{
+    uint64_t v2 = midstate.CountV2(start, count);
+    KSHAKE320Metrics::RecordPoW(false, count - v2);
+    KSHAKE320Metrics::RecordPoW(true, v2);
 }
 
-template<typename T1>
-inline uint320 Hash320(const T1 pbegin, const T1 pend)
+// Common part of getPoWHash, getHash320, getHash256, getSHA256d and
+// getHash160 once the arguments are parsed.
+static PyObject *kshake320_hashcall(int kind, PyObject *dataObj, PyObject *out)
 {
-    static unsigned char pblank[1];
-    uint320 hash;
-    SHAKE320((pbegin == pend ? pblank : (unsigned char*)&pbegin[0]), (pend - pbegin) * sizeof(pbegin[0]) * 8, (unsigned char*)&hash, sizeof(hash));
-    return hash;
+    Py_buffer input, output;
+    PyObject *value;
+    char *data;
+
+    if (PyObject_GetBuffer(dataObj, &input, PyBUF_SIMPLE) < 0)
+        return NULL;
+    if (kind == KSHAKE320_POW && input.len < 120) {
+        PyBuffer_Release(&input);
+        PyErr_SetString(PyExc_ValueError, "header must be at least 120 bytes long");
+        return NULL;
+    }
+    static const Py_ssize_t sizes[] = { 40, 40, 32, 32, 20 };
+    static const KSHAKE320Metrics::Entry entries[] = {
+        KSHAKE320Metrics::GETPOWHASH, KSHAKE320Metrics::GETHASH320, KSHAKE320Metrics::GETHASH256,
+        KSHAKE320Metrics::GETSHA256D, KSHAKE320Metrics::GETHASH160,
+    };
+    value = kshake320_openoutput(out, sizes[kind], &output, &data);
+    if (value != NULL) {
+        // Both buffers stay exported until the end, so they can be used without the GIL
+        PyThreadState *save = NULL;
+        if (kind == KSHAKE320_POW || input.len >= KSHAKE320_GIL_MINSIZE)
+            save = PyEval_SaveThread();
+        uint64_t begin = KSHAKE320Metrics::Ticks();
+        if (kind == KSHAKE320_POW)
+            kshake320_pow((const unsigned char *)input.buf, (unsigned char *)data);
+        else if (kind == KSHAKE320_HASH320)
+            kshake320_hash320((const unsigned char *)input.buf, (size_t)input.len, (unsigned char *)data);
+        else if (kind == KSHAKE320_HASH256)
+            kshake320_hash256((const unsigned char *)input.buf, (size_t)input.len, (unsigned char *)data);
+        else if (kind == KSHAKE320_SHA256D)
+            kshake320_sha256d((const unsigned char *)input.buf, (size_t)input.len, (unsigned char *)data);
+        else
+            kshake320_hash160((const unsigned char *)input.buf, (size_t)input.len, (unsigned char *)data);
+        uint64_t ticks = KSHAKE320Metrics::Ticks() - begin;
+        if (save != NULL)
+            PyEval_RestoreThread(save);
+        if (kind == KSHAKE320_POW)
+            KSHAKE320Metrics::RecordPoWHeaders((const char *)input.buf, 1);
+        KSHAKE320Metrics::Record(entries[kind], kind == KSHAKE320_POW ? 120 : (uint64_t)input.len, ticks);
+        kshake320_closeoutput(&output);
+    }
+    PyBuffer_Release(&input);
+    return value;
 }
 
-template<typename T1>
-inline uint256 Hash256(const T1 pbegin, const T1 pend)
+#if PY_VERSION_HEX >= 0x03070000
+// Vectorcall entry points: the arguments are taken from the caller's array
+// instead of a tuple and a dict.
+#define KSHAKE320_CALL_FLAGS (METH_FASTCALL | METH_KEYWORDS)
+
+// Parses (data, out=None), data being named dataName.
+static int kshake320_parsefast(const char *fname, const char *dataName, PyObject *const *args, Py_ssize_t nargs,
+                               PyObject *kwnames, PyObject **data, PyObject **out)
 {
-    static unsigned char pblank[1];
-    uint256 hash1;
-    SHA3_256((pbegin == pend ? pblank : (unsigned char*)&pbegin[0]), (pend - pbegin) * sizeof(pbegin[0]), (unsigned char*)&hash1);
-    uint256 hash2;
-    SHA3_256((unsigned char*)&hash1, sizeof(hash1), (unsigned char*)&hash2);
-    return hash2;
+    if (nargs > 2) {
+        PyErr_Format(PyExc_TypeError, "%s() takes at most 2 arguments (%zd given)", fname, nargs);
+        return 0;
+    }
+    *data = nargs > 0 ? args[0] : NULL;
+    *out = nargs > 1 ? args[1] : NULL;
+    if (kwnames != NULL) {
+        for (Py_ssize_t i = 0; i < PyTuple_GET_SIZE(kwnames); i++) {
+            PyObject *name = PyTuple_GET_ITEM(kwnames, i);
+            PyObject **slot;
+            if (PyUnicode_CompareWithASCIIString(name, dataName) == 0)
+                slot = data;
+            else if (PyUnicode_CompareWithASCIIString(name, "out") == 0)
+                slot = out;
+            else {
+                PyErr_Format(PyExc_TypeError, "%s() got an unexpected keyword argument '%U'", fname, name);
+                return 0;
+            }
+            if (*slot != NULL) {
+                PyErr_Format(PyExc_TypeError, "%s() got multiple values for argument '%U'", fname, name);
+                return 0;
+            }
+            *slot = args[nargs + i];
+        }
+    }
+    if (*data == NULL) {
+        PyErr_Format(PyExc_TypeError, "%s() missing required argument '%s'", fname, dataName);
+        return 0;
+    }
+    return 1;
 }
 
-static void KSHAKE320POW(const char *input, char *output)
+#define KSHAKE320_HASHFUNCTION(function, kind, fname, dataName) \
+static PyObject *function(PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames) \
+{ \
+    PyObject *data, *out; \
+    if (!kshake320_parsefast(fname, dataName, args, nargs, kwnames, &data, &out)) \
+        return NULL; \
+    return kshake320_hashcall(kind, data, out); \
+}
+
+#else
+#define KSHAKE320_CALL_FLAGS (METH_VARARGS | METH_KEYWORDS)
+
+#define KSHAKE320_HASHFUNCTION(function, kind, fname, dataName) \
+static PyObject *function(PyObject *self, PyObject *args, PyObject *kwds) \
+{ \
+    static char *kwlist[] = { (char *)dataName, (char *)"out", NULL }; \
+    PyObject *data, *out = NULL; \
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|O:" fname, kwlist, &data, &out)) \
+        return NULL; \
+    return kshake320_hashcall(kind, data, out); \
+}
+#endif
+
+KSHAKE320_HASHFUNCTION(kshake320_getpowhash, KSHAKE320_POW, "getPoWHash", "header")
+KSHAKE320_HASHFUNCTION(kshake320_gethash320, KSHAKE320_HASH320, "getHash320", "data")
+KSHAKE320_HASHFUNCTION(kshake320_gethash256, KSHAKE320_HASH256, "getHash256", "data")
+KSHAKE320_HASHFUNCTION(kshake320_getsha256d, KSHAKE320_SHA256D, "getSHA256d", "data")
+KSHAKE320_HASHFUNCTION(kshake320_gethash160, KSHAKE320_HASH160, "getHash160", "data")
+
+// Raises ValueError when the len bytes at out share a byte with the inLen
+// bytes at in: the batches read headers after writing the first hashes.
+static int kshake320_checkoverlap(const char *out, Py_ssize_t len, const void *in, Py_ssize_t inLen)
+{
+    uintptr_t o = (uintptr_t)out, i = (uintptr_t)in;
+    if (len > 0 && inLen > 0 && o < i + (uintptr_t)inLen && i < o + (uintptr_t)len) {
+        PyErr_SetString(PyExc_ValueError, "out must not overlap headers");
+        return 0;
+    }
+    return 1;
+}
+
+static PyObject *kshake320_getpowhashbatch(PyObject *self, PyObject *args, PyObject *kwds)
 {
-    uint320 hash;
-    int version = *((int *)input);
+    static char *kwlist[] = { (char *)"headers", (char *)"count", (char *)"out", NULL };
+    Py_buffer input, output;
+    Py_ssize_t count;
+    PyObject *out = NULL;
+    PyObject *value;
+    char *data;
+    bool failed = false;
 
-    if (version <= 1) {
-        hash = KryptoHash(input, input + 120);
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, KSHAKE320_BUFFER "n|O", kwlist, &input, &count, &out))
+        return NULL;
+    if (count < 0 || input.len / 120 < count) {
+        PyBuffer_Release(&input);
+        PyErr_SetString(PyExc_ValueError, "buffer must hold count 120-byte headers");
+        return NULL;
     }
-    else {
-        hash = KSHAKE320v2(input, input + 120);
+    value = kshake320_openoutput(out, count * 40, &output, &data);
+    if (value != NULL && !kshake320_checkoverlap(data, count * 40, input.buf, count * 120)) {
+        kshake320_closeoutput(&output);
+        Py_CLEAR(value);
+    }
+    if (value != NULL) {
+        uint64_t ticks;
+        Py_BEGIN_ALLOW_THREADS
+        uint64_t begin = KSHAKE320Metrics::Ticks();
+        failed = kshake320_pow_batch((const unsigned char *)input.buf, (size_t)count, (unsigned char *)data, 1) != 0;
+        ticks = KSHAKE320Metrics::Ticks() - begin;
+        Py_END_ALLOW_THREADS
+        kshake320_closeoutput(&output);
+        if (failed) {
+            Py_DECREF(value);
+            value = PyErr_NoMemory();
+        }
+        else {
+            KSHAKE320Metrics::RecordPoWHeaders((const char *)input.buf, (size_t)count);
+            KSHAKE320Metrics::Record(KSHAKE320Metrics::GETPOWHASHBATCH, (uint64_t)count * 120, ticks);
+        }
     }
-    memcpy(output, &hash, 40);
+    PyBuffer_Release(&input);
+    return value;
 }
 
-static void GetHash320(const char *input, int len, char *output)
+// Checks that view is a C-contiguous 2-D array of bytes with rows of
+// rowLength bytes, or the number of rows when it is not given.
+static int kshake320_checkarray(const Py_buffer *view, const char *name, Py_ssize_t rowLength, Py_ssize_t rows)
 {
-    uint320 hash = Hash320(input, input + len);
-    memcpy(output, &hash, 40);
+    if (view->ndim != 2 || view->itemsize != 1 || view->shape[1] != rowLength || (rows >= 0 && view->shape[0] != rows)) {
+        if (rows >= 0)
+            PyErr_Format(PyExc_ValueError, "%s must be a 2-D array of bytes of shape (%zd, %zd)", name, rows, rowLength);
+        else
+            PyErr_Format(PyExc_ValueError, "%s must be a 2-D array of bytes of shape (n, %zd)", name, rowLength);
+        return 0;
+    }
+    return 1;
 }
 
-static void GetHash256(const char *input, int len, char *output)
+static PyObject *kshake320_getpowhasharray(PyObject *self, PyObject *args, PyObject *kwds)
 {
-    uint256 hash = Hash256(input, input + len);
-    memcpy(output, &hash, 32);
+    static char *kwlist[] = { (char *)"headers", (char *)"out", (char *)"threads", NULL };
+    PyObject *headersObj, *out;
+    int threads = 1;
+    Py_buffer input, output;
+    bool failed = false;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OO|i", kwlist, &headersObj, &out, &threads))
+        return NULL;
+    if (threads < 0) {
+        PyErr_SetString(PyExc_ValueError, "threads must not be negative");
+        return NULL;
+    }
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    if (PyObject_GetBuffer(headersObj, &input, PyBUF_C_CONTIGUOUS) < 0)
+        return NULL;
+    if (!kshake320_checkarray(&input, "headers", 120, -1)) {
+        PyBuffer_Release(&input);
+        return NULL;
+    }
+    if (PyObject_GetBuffer(out, &output, PyBUF_C_CONTIGUOUS | PyBUF_WRITABLE) < 0) {
+        PyBuffer_Release(&input);
+        return NULL;
+    }
+    size_t count = (size_t)input.shape[0];
+    if (kshake320_checkarray(&output, "out", 40, input.shape[0])
+        && kshake320_checkoverlap((const char *)output.buf, output.len, input.buf, input.len)) {
+        uint64_t ticks;
+        Py_BEGIN_ALLOW_THREADS
+        uint64_t begin = KSHAKE320Metrics::Ticks();
+        failed = kshake320_pow_batch((const unsigned char *)input.buf, count, (unsigned char *)output.buf, (unsigned int)threads) != 0;
+        ticks = KSHAKE320Metrics::Ticks() - begin;
+        Py_END_ALLOW_THREADS
+        if (failed)
+            PyErr_NoMemory();
+        else {
+            KSHAKE320Metrics::RecordPoWHeaders((const char *)input.buf, count);
+            KSHAKE320Metrics::Record(KSHAKE320Metrics::GETPOWHASHARRAY, (uint64_t)count * 120, ticks);
+        }
+    }
+    PyBuffer_Release(&output);
+    PyBuffer_Release(&input);
+    if (PyErr_Occurred())
+        return NULL;
+    Py_INCREF(out);
+    return out;
 }
 
-static PyObject *kshake320_getpowhash(PyObject *self, PyObject *args)
+// Builds the list of (nonce, hash) tuples returned by the scan functions.
+static PyObject *kshake320_buildresults(const std::vector<std::pair<uint32_t, uint320> > &found)
 {
-    char *output;
-    PyObject *value;
+    PyObject *list = PyList_New(found.size());
+    if (list == NULL)
+        return NULL;
+    for (size_t i = 0; i < found.size(); i++) {
 #if PY_MAJOR_VERSION >= 3
-    PyBytesObject *input;
+        PyObject *item = Py_BuildValue("(ky#)", (unsigned long)found[i].first, (const char *)found[i].second.begin(), (Py_ssize_t)40);
 #else
-    PyStringObject *input;
+        PyObject *item = Py_BuildValue("(ks#)", (unsigned long)found[i].first, (const char *)found[i].second.begin(), (Py_ssize_t)40);
 #endif
-    if (!PyArg_ParseTuple(args, "S", &input))
-        return NULL;
-    Py_INCREF(input);
-    output = (char*)PyMem_Malloc(40);
+        if (item == NULL) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_SET_ITEM(list, i, item);
+    }
+    return list;
+}
 
+// Converts a non-negative int below 2**320, or 40 little-endian bytes, to a uint320.
+static int kshake320_parsetarget(PyObject *obj, uint320 *target)
+{
 #if PY_MAJOR_VERSION >= 3
-    KSHAKE320POW((char *)PyBytes_AsString((PyObject*) input), output);
+    if (PyBytes_Check(obj)) {
+        if (PyBytes_GET_SIZE(obj) != 40) {
+            PyErr_SetString(PyExc_ValueError, "target must be 40 bytes long");
+            return 0;
+        }
+        memcpy(target->begin(), PyBytes_AS_STRING(obj), 40);
+        return 1;
+    }
+    if (!PyLong_Check(obj)) {
+        PyErr_SetString(PyExc_TypeError, "target must be an int or bytes");
+        return 0;
+    }
+    PyObject *bytes = PyObject_CallMethod(obj, "to_bytes", "is", 40, "little");
+    if (bytes == NULL)
+        return 0;
+    memcpy(target->begin(), PyBytes_AS_STRING(bytes), 40);
+    Py_DECREF(bytes);
+    return 1;
 #else
-    KSHAKE320POW((char *)PyString_AsString((PyObject*) input), output);
+    if (PyString_Check(obj)) {
+        if (PyString_GET_SIZE(obj) != 40) {
+            PyErr_SetString(PyExc_ValueError, "target must be 40 bytes long");
+            return 0;
+        }
+        memcpy(target->begin(), PyString_AS_STRING(obj), 40);
+        return 1;
+    }
+    if (!PyInt_Check(obj) && !PyLong_Check(obj)) {
+        PyErr_SetString(PyExc_TypeError, "target must be an int, a long or a str");
+        return 0;
+    }
+    PyObject *value = PyNumber_Long(obj);
+    if (value == NULL)
+        return 0;
+    int result = _PyLong_AsByteArray((PyLongObject *)value, target->begin(), 40, 1, 0);
+    Py_DECREF(value);
+    return result == 0;
 #endif
-    Py_DECREF(input);
-#if PY_MAJOR_VERSION >= 3
-    value = Py_BuildValue("y#", output, 40);
+}
+
+// Checks a header template and its nonce offset, copies the header and
+// releases its buffer.
+static int kshake320_checkheader(Py_buffer *headerBuf, char *header, Py_ssize_t nonceOffset)
+{
+    Py_ssize_t headerLen = headerBuf->len;
+
+    if (headerLen >= 120)
+        memcpy(header, headerBuf->buf, 120);
+    PyBuffer_Release(headerBuf);
+    if (headerLen < 120) {
+        PyErr_SetString(PyExc_ValueError, "header must be at least 120 bytes long");
+        return 0;
+    }
+    if (nonceOffset < 0 || nonceOffset > 120 - 4) {
+        PyErr_SetString(PyExc_ValueError, "nonce_offset must be between 0 and 116");
+        return 0;
+    }
+    return 1;
+}
+
+static int kshake320_checkrange(unsigned long long start, unsigned long long count, PyObject *targetObj, uint320 *target)
+{
+    if (start > 0xffffffffULL || count > 0x100000000ULL - start) {
+        PyErr_SetString(PyExc_OverflowError, "the nonce range must fit in 32 bits");
+        return 0;
+    }
+    return kshake320_parsetarget(targetObj, target);
+}
+
+// Checks the arguments shared by scan() and NonceSearcher, copies the
+// header and releases its buffer.
+static int kshake320_checkscan(Py_buffer *headerBuf, char *header, Py_ssize_t nonceOffset, unsigned long long start, unsigned long long count,
+                               PyObject *targetObj, uint320 *target)
+{
+    return kshake320_checkheader(headerBuf, header, nonceOffset) && kshake320_checkrange(start, count, targetObj, target);
+}
+
+static PyObject *kshake320_scan(PyObject *self, PyObject *args)
+{
+    Py_buffer headerBuf;
+    char header[120];
+    Py_ssize_t nonceOffset;
+    unsigned long long start, count;
+    PyObject *targetObj;
+    uint320 target;
+
+    if (!PyArg_ParseTuple(args, KSHAKE320_BUFFER "nKKO", &headerBuf, &nonceOffset, &start, &count, &targetObj))
+        return NULL;
+    if (!kshake320_checkscan(&headerBuf, header, nonceOffset, start, count, targetObj, &target))
+        return NULL;
+
+    KSHAKE320Midstate midstate(header, (unsigned int)nonceOffset);
+    std::vector<std::pair<uint32_t, uint320> > found;
+    uint64_t ticks;
+    Py_BEGIN_ALLOW_THREADS
+    uint64_t begin = KSHAKE320Metrics::Ticks();
+    KSHAKE320Scan(midstate, start, count, target, found);
+    ticks = KSHAKE320Metrics::Ticks() - begin;
+    Py_END_ALLOW_THREADS
+    kshake320_recordscan(midstate, start, count);
+    KSHAKE320Metrics::Record(KSHAKE320Metrics::SCAN, count * 120, ticks);
+
+    return kshake320_buildresults(found);
+}
+
+// Free-threaded builds lock the object where the GIL used to serialize
+// the calls on it.
+#ifdef Py_GIL_DISABLED
+#define KSHAKE320_BEGIN_CRITICAL_SECTION(op) Py_BEGIN_CRITICAL_SECTION(op)
+#define KSHAKE320_END_CRITICAL_SECTION() Py_END_CRITICAL_SECTION()
+#else
+#define KSHAKE320_BEGIN_CRITICAL_SECTION(op) {
+#define KSHAKE320_END_CRITICAL_SECTION() }
+#endif
+
+// The types are created for each module object from a PyType_Spec, so that
+// interpreters do not share them. Python 2 has neither specs nor heap types
+// made from them: the few slots used here are copied to a type of its own.
+#if PY_MAJOR_VERSION < 3
+enum { Py_tp_clear = 1, Py_tp_dealloc, Py_tp_doc, Py_tp_getset, Py_tp_methods, Py_tp_new, Py_tp_traverse };
+
+typedef struct {
+    int slot;
+    void *pfunc;
+} PyType_Slot;
+
+typedef struct {
+    const char *name;
+    int basicsize;
+    int itemsize;
+    unsigned int flags;
+    PyType_Slot *slots;
+} PyType_Spec;
+#endif
+
+#if PY_VERSION_HEX >= 0x030A0000
+#define KSHAKE320_TPFLAGS (Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE)
+#else
+#define KSHAKE320_TPFLAGS Py_TPFLAGS_DEFAULT
+#endif
+
+static PyObject *kshake320_typefromspec(PyObject *module, PyType_Spec *spec)
+{
+#if PY_VERSION_HEX >= 0x03090000
+    return PyType_FromModuleAndSpec(module, spec, NULL);
+#elif PY_MAJOR_VERSION >= 3
+    return PyType_FromSpec(spec);
 #else
-    value = Py_BuildValue("s#", output, 40);
+    static const PyTypeObject blank = { PyVarObject_HEAD_INIT(NULL, 0) };
+    PyTypeObject *type = (PyTypeObject *)PyMem_Malloc(sizeof(PyTypeObject));
+    if (type == NULL)
+        return PyErr_NoMemory();
+    *type = blank;
+    type->tp_name = spec->name;
+    type->tp_basicsize = spec->basicsize;
+    type->tp_itemsize = spec->itemsize;
+    type->tp_flags = spec->flags;
+    for (PyType_Slot *slot = spec->slots; slot->slot != 0; slot++) {
+        switch (slot->slot) {
+        case Py_tp_clear: type->tp_clear = (inquiry)slot->pfunc; break;
+        case Py_tp_dealloc: type->tp_dealloc = (destructor)slot->pfunc; break;
+        case Py_tp_doc: type->tp_doc = (const char *)slot->pfunc; break;
+        case Py_tp_getset: type->tp_getset = (PyGetSetDef *)slot->pfunc; break;
+        case Py_tp_methods: type->tp_methods = (PyMethodDef *)slot->pfunc; break;
+        case Py_tp_new: type->tp_new = (newfunc)slot->pfunc; break;
+        case Py_tp_traverse: type->tp_traverse = (traverseproc)slot->pfunc; break;
+        }
+    }
+    // The module is never unloaded, nor is its type
+    if (PyType_Ready(type) < 0) {
+        PyMem_Free(type);
+        return NULL;
+    }
+    return (PyObject *)type;
+#endif
+}
+
+// tp_dealloc ends here. Since Python 3.8 the objects of a heap type hold a
+// reference to it.
+static void kshake320_free(PyObject *self)
+{
+    PyTypeObject *type = Py_TYPE(self);
+    type->tp_free(self);
+#if PY_VERSION_HEX >= 0x03080000
+    Py_DECREF(type);
 #endif
-    PyMem_Free(output);
+}
+
+typedef struct {
+    PyObject_HEAD
+    KSHAKE320Midstate *midstate;        // storage aligned as its sponge wants it
+    char storage[sizeof(KSHAKE320Midstate) + 32];
+} PowJobObject;
+
+static PyObject *PowJob_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = { (char *)"header", (char *)"nonce_offset", NULL };
+    Py_buffer headerBuf;
+    char header[120];
+    Py_ssize_t nonceOffset = 116;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, KSHAKE320_BUFFER "|n", kwlist, &headerBuf, &nonceOffset))
+        return NULL;
+    if (!kshake320_checkheader(&headerBuf, header, nonceOffset))
+        return NULL;
+
+    PowJobObject *self = (PowJobObject *)type->tp_alloc(type, 0);
+    if (self == NULL)
+        return NULL;
+    void *storage = (void *)(((uintptr_t)self->storage + 31) & ~(uintptr_t)31);
+    self->midstate = new (storage) KSHAKE320Midstate(header, (unsigned int)nonceOffset);
+    return (PyObject *)self;
+}
+
+static void PowJob_dealloc(PowJobObject *self)
+{
+    self->midstate->~KSHAKE320Midstate();
+    kshake320_free((PyObject *)self);
+}
+
+static PyObject *PowJob_hash(PowJobObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = { (char *)"nonce", (char *)"out", NULL };
+    unsigned long long nonce;
+    PyObject *out = NULL;
+    Py_buffer output;
+    char *data;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "K|O", kwlist, &nonce, &out))
+        return NULL;
+    if (nonce > 0xffffffffULL) {
+        PyErr_SetString(PyExc_OverflowError, "nonce must fit in 32 bits");
+        return NULL;
+    }
+    PyObject *value = kshake320_openoutput(out, 40, &output, &data);
+    if (value == NULL)
+        return NULL;
+    uint64_t ticks;
+    Py_BEGIN_ALLOW_THREADS
+    uint64_t begin = KSHAKE320Metrics::Ticks();
+    self->midstate->Hash((uint32_t)nonce, data);
+    ticks = KSHAKE320Metrics::Ticks() - begin;
+    Py_END_ALLOW_THREADS
+    kshake320_closeoutput(&output);
+    KSHAKE320Metrics::RecordPoW(self->midstate->V2((uint32_t)nonce), 1);
+    KSHAKE320Metrics::Record(KSHAKE320Metrics::POWJOB_HASH, 120, ticks);
     return value;
 }
 
-static PyObject *kshake320_gethash320(PyObject *self, PyObject *args)
+static PyObject *PowJob_scan(PowJobObject *self, PyObject *args)
 {
-    char *output;
-    PyObject *value;
-#if PY_MAJOR_VERSION >= 3
-    PyBytesObject *input;
+    unsigned long long start, count;
+    PyObject *targetObj;
+    uint320 target;
+
+    if (!PyArg_ParseTuple(args, "KKO", &start, &count, &targetObj))
+        return NULL;
+    if (!kshake320_checkrange(start, count, targetObj, &target))
+        return NULL;
+
+    std::vector<std::pair<uint32_t, uint320> > found;
+    uint64_t ticks;
+    Py_BEGIN_ALLOW_THREADS
+    uint64_t begin = KSHAKE320Metrics::Ticks();
+    KSHAKE320Scan(*self->midstate, start, count, target, found);
+    ticks = KSHAKE320Metrics::Ticks() - begin;
+    Py_END_ALLOW_THREADS
+    kshake320_recordscan(*self->midstate, start, count);
+    KSHAKE320Metrics::Record(KSHAKE320Metrics::POWJOB_SCAN, count * 120, ticks);
+    return kshake320_buildresults(found);
+}
+
+static PyObject *PowJob_getversion(PowJobObject *self, void *closure)
+{
+    return PyLong_FromLong(self->midstate->V2() ? 2 : 1);
+}
+
+static PyObject *PowJob_getnonceoffset(PowJobObject *self, void *closure)
+{
+    return PyLong_FromLong((long)self->midstate->NonceOffset());
+}
+
+static PyMethodDef PowJobMethods[] = {
+    { "hash", (PyCFunction)(void (*)(void))PowJob_hash, METH_VARARGS | METH_KEYWORDS, "hash(nonce, out=None)\n"
+        "Returns the pow hash of the header with nonce written at nonce_offset, or writes it to the 40-byte out" },
+    { "scan", (PyCFunction)PowJob_scan, METH_VARARGS, "scan(start, count, target) -> [(nonce, hash), ...]\n"
+        "Same as the module scan() on the header of the job" },
+    { NULL, NULL, 0, NULL }
+};
+
+static PyGetSetDef PowJobGetSet[] = {
+    { (char *)"version", (getter)PowJob_getversion, NULL, (char *)"PoW version of the header as given, 1 or 2; a nonce_offset below 4\n"
+        "writes the nonce over the version, which then depends on the nonce", NULL },
+    { (char *)"nonce_offset", (getter)PowJob_getnonceoffset, NULL, (char *)"Offset of the nonce in the header", NULL },
+    { NULL, NULL, NULL, NULL, NULL }
+};
+
+static PyType_Slot PowJobSlots[] = {
+    { Py_tp_dealloc, (void *)PowJob_dealloc },
+    { Py_tp_doc, (void *)"PowJob(header, nonce_offset=116)\n"
+        "Header template of a mining job, prepared once to hash many nonces.\n"
+        "The version is read and the bytes before the nonce are absorbed when the job is made." },
+    { Py_tp_methods, PowJobMethods },
+    { Py_tp_getset, PowJobGetSet },
+    { Py_tp_new, (void *)PowJob_new },
+    { 0, NULL }
+};
+
+static PyType_Spec PowJobSpec = {
+    "kshake320_hash.PowJob", sizeof(PowJobObject), 0, KSHAKE320_TPFLAGS, PowJobSlots
+};
+
+// The methods that wait without the GIL hold a reference to the pool, so
+// that close() from another thread only drops that of the object.
+typedef struct {
+    PyObject_HEAD
+    std::shared_ptr<KSHAKE320Searcher> searcher;    // built in NonceSearcher_new
+} NonceSearcherObject;
+
+static const char *kshake320_statusname(KSHAKE320Searcher::Status status)
+{
+    switch (status) {
+    case KSHAKE320Searcher::SOLVED:
+        return "solved";
+    case KSHAKE320Searcher::EXHAUSTED:
+        return "exhausted";
+    case KSHAKE320Searcher::CANCELLED:
+        return "cancelled";
+    default:
+        return "running";
+    }
+}
+
+static PyObject *NonceSearcher_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = { (char *)"threads", (char *)"chunk_size", NULL };
+    int threads = 0;
+    int chunkSize = 64;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|ii", kwlist, &threads, &chunkSize))
+        return NULL;
+    if (threads < 0 || chunkSize <= 0) {
+        PyErr_SetString(PyExc_ValueError, "threads must be non-negative and chunk_size positive");
+        return NULL;
+    }
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    NonceSearcherObject *self = (NonceSearcherObject *)type->tp_alloc(type, 0);
+    if (self == NULL)
+        return NULL;
+    new (&self->searcher) std::shared_ptr<KSHAKE320Searcher>();
+    try {
+        self->searcher.reset(new KSHAKE320Searcher((unsigned int)threads, (unsigned int)chunkSize));
+    }
+    catch (const std::exception &e) {
+        Py_DECREF(self);
+        PyErr_SetString(PyExc_RuntimeError, e.what());
+        return NULL;
+    }
+    return (PyObject *)self;
+}
+
+// A reference to the pool, empty with ValueError once it is closed.
+static std::shared_ptr<KSHAKE320Searcher> NonceSearcher_get(NonceSearcherObject *self)
+{
+    std::shared_ptr<KSHAKE320Searcher> searcher;
+    KSHAKE320_BEGIN_CRITICAL_SECTION(self);
+    searcher = self->searcher;
+    KSHAKE320_END_CRITICAL_SECTION();
+    if (!searcher)
+        PyErr_SetString(PyExc_ValueError, "NonceSearcher is closed");
+    return searcher;
+}
+
+// Drops a reference to the pool. The last one joins the workers, which may
+// need the GIL to call a submit() callback. Dropped from such a callback, it
+// leaves the worker running it to end once the callback returns.
+static void NonceSearcher_release(std::shared_ptr<KSHAKE320Searcher> &searcher)
+{
+    Py_BEGIN_ALLOW_THREADS
+    searcher.reset();
+    Py_END_ALLOW_THREADS
+}
+
+// Cancels the running job and drops the reference of the object: the
+// workers stop once the calls still waiting on the pool have returned.
+static void NonceSearcher_stop(NonceSearcherObject *self)
+{
+    std::shared_ptr<KSHAKE320Searcher> searcher;
+    KSHAKE320_BEGIN_CRITICAL_SECTION(self);
+    searcher.swap(self->searcher);
+    KSHAKE320_END_CRITICAL_SECTION();
+    if (!searcher)
+        return;
+    searcher->Cancel();
+    NonceSearcher_release(searcher);
+}
+
+static void NonceSearcher_dealloc(NonceSearcherObject *self)
+{
+    NonceSearcher_stop(self);
+    self->searcher.~shared_ptr();
+    kshake320_free((PyObject *)self);
+}
+
+static PyObject *NonceSearcher_search(NonceSearcherObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = { (char *)"header", (char *)"nonce_offset", (char *)"start", (char *)"count",
+                              (char *)"target", (char *)"stop_on_first", NULL };
+    Py_buffer headerBuf;
+    char header[120];
+    Py_ssize_t nonceOffset;
+    unsigned long long start, count;
+    PyObject *targetObj;
+    int stopOnFirst = 1;
+    uint320 target;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, KSHAKE320_BUFFER "nKKO|i", kwlist,
+                                     &headerBuf, &nonceOffset, &start, &count, &targetObj, &stopOnFirst))
+        return NULL;
+    if (!kshake320_checkscan(&headerBuf, header, nonceOffset, start, count, targetObj, &target))
+        return NULL;
+    std::shared_ptr<KSHAKE320Searcher> searcher = NonceSearcher_get(self);
+    if (!searcher)
+        return NULL;
+
+    std::shared_ptr<KSHAKE320Searcher::Job> job;
+    uint64_t ticks;
+    Py_BEGIN_ALLOW_THREADS
+    uint64_t begin = KSHAKE320Metrics::Ticks();
+    job = searcher->Submit(header, (unsigned int)nonceOffset, start, count, target, stopOnFirst != 0, nullptr);
+    searcher->Wait(job);
+    ticks = KSHAKE320Metrics::Ticks() - begin;
+    searcher.reset();
+    Py_END_ALLOW_THREADS
+    // The workers counted the headers they hashed
+    KSHAKE320Metrics::Record(KSHAKE320Metrics::NONCESEARCHER_SEARCH, job->hashed * 120, ticks);
+    return kshake320_buildresults(job->results);
+}
+
+static PyObject *NonceSearcher_submit(NonceSearcherObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = { (char *)"header", (char *)"nonce_offset", (char *)"start", (char *)"count",
+                              (char *)"target", (char *)"callback", (char *)"stop_on_first", NULL };
+    Py_buffer headerBuf;
+    char header[120];
+    Py_ssize_t nonceOffset;
+    unsigned long long start, count;
+    PyObject *targetObj, *callback;
+    int stopOnFirst = 1;
+    uint320 target;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, KSHAKE320_BUFFER "nKKOO|i", kwlist,
+                                     &headerBuf, &nonceOffset, &start, &count, &targetObj, &callback, &stopOnFirst))
+        return NULL;
+    if (!kshake320_checkscan(&headerBuf, header, nonceOffset, start, count, targetObj, &target))
+        return NULL;
+    if (!PyCallable_Check(callback)) {
+        PyErr_SetString(PyExc_TypeError, "callback must be callable");
+        return NULL;
+    }
+    std::shared_ptr<KSHAKE320Searcher> searcher = NonceSearcher_get(self);
+    if (!searcher)
+        return NULL;
+
+    // The reference to the callback is released by the worker that calls it,
+    // in the interpreter that submitted the job: the PyGILState functions
+    // only know the main one.
+    Py_INCREF(callback);
+#if PY_VERSION_HEX >= 0x03090000
+    PyInterpreterState *interp = PyInterpreterState_Get();
 #else
-    PyStringObject *input;
+    PyInterpreterState *interp = PyThreadState_Get()->interp;
 #endif
-    if (!PyArg_ParseTuple(args, "S", &input))
+    std::function<void(KSHAKE320Searcher::Job &)> onDone = [callback, interp](KSHAKE320Searcher::Job &job) {
+        PyThreadState *tstate = PyThreadState_New(interp);
+        PyEval_RestoreThread(tstate);
+        PyObject *results = kshake320_buildresults(job.results);
+        if (results != NULL) {
+            PyObject *ret = PyObject_CallFunction(callback, "sO", kshake320_statusname(job.status), results);
+            Py_DECREF(results);
+            Py_XDECREF(ret);
+        }
+        if (PyErr_Occurred())
+            PyErr_WriteUnraisable(callback);
+        Py_DECREF(callback);
+        PyThreadState_Clear(tstate);
+        PyThreadState_DeleteCurrent();
+    };
+    Py_BEGIN_ALLOW_THREADS
+    searcher->Submit(header, (unsigned int)nonceOffset, start, count, target, stopOnFirst != 0, onDone);
+    searcher.reset();
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+static PyObject *NonceSearcher_cancel(NonceSearcherObject *self, PyObject *args)
+{
+    // Cancelling does not wait: the object keeps the pool meanwhile
+    KSHAKE320_BEGIN_CRITICAL_SECTION(self);
+    if (self->searcher)
+        self->searcher->Cancel();
+    KSHAKE320_END_CRITICAL_SECTION();
+    Py_RETURN_NONE;
+}
+
+static PyObject *NonceSearcher_wait(NonceSearcherObject *self, PyObject *args)
+{
+    std::shared_ptr<KSHAKE320Searcher> searcher = NonceSearcher_get(self);
+    if (!searcher)
         return NULL;
-    Py_INCREF(input);
-    output = (char*)PyMem_Malloc(40);
+    Py_BEGIN_ALLOW_THREADS
+    searcher->WaitCurrent();
+    searcher.reset();
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
 
+static PyObject *NonceSearcher_close(NonceSearcherObject *self, PyObject *args)
+{
+    NonceSearcher_stop(self);
+    Py_RETURN_NONE;
+}
+
+static PyObject *NonceSearcher_getthreads(NonceSearcherObject *self, void *closure)
+{
+    unsigned int threads = 0;
+    KSHAKE320_BEGIN_CRITICAL_SECTION(self);
+    if (self->searcher)
+        threads = self->searcher->Threads();
+    KSHAKE320_END_CRITICAL_SECTION();
+    if (threads == 0) {
+        PyErr_SetString(PyExc_ValueError, "NonceSearcher is closed");
+        return NULL;
+    }
 #if PY_MAJOR_VERSION >= 3
-    GetHash320((char *)PyBytes_AsString((PyObject*) input), Py_SIZE((PyObject*) input), output);
+    return PyLong_FromUnsignedLong(threads);
 #else
-    GetHash320((char *)PyString_AsString((PyObject*) input), Py_SIZE((PyObject*) input), output);
+    return PyInt_FromLong(threads);
 #endif
-    Py_DECREF(input);
-#if PY_MAJOR_VERSION >= 3
-    value = Py_BuildValue("y#", output, 40);
+}
+
+static PyMethodDef NonceSearcherMethods[] = {
+    { "search", (PyCFunction)(void (*)(void))NonceSearcher_search, METH_VARARGS | METH_KEYWORDS,
+        "search(header, nonce_offset, start, count, target, stop_on_first=True) -> [(nonce, hash), ...]\n"
+        "Same as scan() on the pool, releasing the GIL until the search ends. With stop_on_first,\n"
+        "the search stops at the first solution, which is not necessarily the lowest nonce" },
+    { "submit", (PyCFunction)(void (*)(void))NonceSearcher_submit, METH_VARARGS | METH_KEYWORDS,
+        "submit(header, nonce_offset, start, count, target, callback, stop_on_first=True)\n"
+        "Starts a search in the background, cancelling the running one, and returns at once.\n"
+        "callback(status, results) is called from a pool thread when the search ends, status being\n"
+        "'solved', 'exhausted' or 'cancelled'; it must not call search() or wait(), but may close()\n"
+        "the searcher or drop the last reference to it" },
+    { "cancel", (PyCFunction)NonceSearcher_cancel, METH_NOARGS, "Stops the running search" },
+    { "wait", (PyCFunction)NonceSearcher_wait, METH_NOARGS, "Waits until the running search ends" },
+    { "close", (PyCFunction)NonceSearcher_close, METH_NOARGS, "Cancels the running search and stops the threads,\n"
+        "once the search() and wait() calls of other threads have returned" },
+    { NULL, NULL, 0, NULL }
+};
+
+static PyGetSetDef NonceSearcherGetSet[] = {
+    { (char *)"threads", (getter)NonceSearcher_getthreads, NULL, (char *)"Number of worker threads", NULL },
+    { NULL, NULL, NULL, NULL, NULL }
+};
+
+static PyType_Slot NonceSearcherSlots[] = {
+    { Py_tp_dealloc, (void *)NonceSearcher_dealloc },
+    { Py_tp_doc, (void *)"NonceSearcher(threads=0, chunk_size=64)\n"
+        "Pool of threads searching nonces, as many as the CPU has when threads is 0.\n"
+        "Idle threads steal chunks of chunk_size nonces from the busy ones." },
+    { Py_tp_methods, NonceSearcherMethods },
+    { Py_tp_getset, NonceSearcherGetSet },
+    { Py_tp_new, (void *)NonceSearcher_new },
+    { 0, NULL }
+};
+
+static PyType_Spec NonceSearcherSpec = {
+    "kshake320_hash.NonceSearcher", sizeof(NonceSearcherObject), 0, KSHAKE320_TPFLAGS, NonceSearcherSlots
+};
+
+#if KSHAKE320_ASYNC
+// hash() queues without the GIL on a reference to the pool of its own, so
+// that close() from another thread only drops that of the object.
+typedef struct {
+    PyObject_HEAD
+    std::shared_ptr<KSHAKE320VerifyPool> pool;     // built in AsyncPoW_new
+    PyObject *loop;                     // event loop of the futures, the running one by default
+    PyObject *futures;                  // request id -> future
+    uint64_t nextId;
+    int attached;                       // the loop watches the pool
+} AsyncPoWObject;
+
+static PyObject *AsyncPoW_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = { (char *)"threads", (char *)"loop", NULL };
+    int threads = 0;
+    PyObject *loop = Py_None;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|iO", kwlist, &threads, &loop))
+        return NULL;
+    if (threads < 0) {
+        PyErr_SetString(PyExc_ValueError, "threads must not be negative");
+        return NULL;
+    }
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    AsyncPoWObject *self = (AsyncPoWObject *)type->tp_alloc(type, 0);
+    if (self == NULL)
+        return NULL;
+    new (&self->pool) std::shared_ptr<KSHAKE320VerifyPool>();
+    self->futures = PyDict_New();
+    if (self->futures == NULL) {
+        Py_DECREF(self);
+        return NULL;
+    }
+    if (loop != Py_None) {
+        Py_INCREF(loop);
+        self->loop = loop;
+    }
+    try {
+        self->pool.reset(new KSHAKE320VerifyPool((unsigned int)threads));
+    }
+    catch (const std::exception &e) {
+        Py_DECREF(self);
+        PyErr_SetString(PyExc_RuntimeError, e.what());
+        return NULL;
+    }
+    return (PyObject *)self;
+}
+
+// Drops a reference to the pool. The last one joins the workers, which is
+// done without the GIL.
+static void AsyncPoW_release(std::shared_ptr<KSHAKE320VerifyPool> &pool)
+{
+    Py_BEGIN_ALLOW_THREADS
+    pool.reset();
+    Py_END_ALLOW_THREADS
+}
+
+static void AsyncPoW_stop(AsyncPoWObject *self)
+{
+    std::shared_ptr<KSHAKE320VerifyPool> pool;
+
+    pool.swap(self->pool);
+    if (pool)
+        AsyncPoW_release(pool);
+}
+
+static int AsyncPoW_traverse(AsyncPoWObject *self, visitproc visit, void *arg)
+{
+#if PY_VERSION_HEX >= 0x03090000
+    Py_VISIT(Py_TYPE(self));
+#endif
+    Py_VISIT(self->loop);
+    Py_VISIT(self->futures);
+    return 0;
+}
+
+static int AsyncPoW_clear(AsyncPoWObject *self)
+{
+    Py_CLEAR(self->loop);
+    Py_CLEAR(self->futures);
+    return 0;
+}
+
+static void AsyncPoW_dealloc(AsyncPoWObject *self)
+{
+    PyObject_GC_UnTrack(self);
+    AsyncPoW_stop(self);
+    self->pool.~shared_ptr();
+    AsyncPoW_clear(self);
+    kshake320_free((PyObject *)self);
+}
+
+static int AsyncPoW_checkopen(AsyncPoWObject *self)
+{
+    if (!self->pool) {
+        PyErr_SetString(PyExc_ValueError, "AsyncPoW is closed");
+        return 0;
+    }
+    return 1;
+}
+
+// Makes the event loop call drain() whenever hashes are ready.
+static int AsyncPoW_attach(AsyncPoWObject *self)
+{
+    if (self->loop == NULL) {
+        PyObject *asyncio = PyImport_ImportModule("asyncio");
+        if (asyncio == NULL)
+            return 0;
+#if PY_VERSION_HEX >= 0x03070000
+        self->loop = PyObject_CallMethod(asyncio, "get_running_loop", NULL);
 #else
-    value = Py_BuildValue("s#", output, 40);
+        self->loop = PyObject_CallMethod(asyncio, "get_event_loop", NULL);
 #endif
-    PyMem_Free(output);
-    return value;
+        Py_DECREF(asyncio);
+        if (self->loop == NULL)
+            return 0;
+    }
+    PyObject *drain = PyObject_GetAttrString((PyObject *)self, "drain");
+    PyObject *ret = drain == NULL ? NULL : PyObject_CallMethod(self->loop, "add_reader", "iO", self->pool->Fd(), drain);
+    Py_XDECREF(drain);
+    if (ret == NULL)
+        return 0;
+    Py_DECREF(ret);
+    self->attached = 1;
+    return 1;
+}
+
+static PyObject *AsyncPoW_hash(AsyncPoWObject *self, PyObject *args)
+{
+    Py_buffer headerBuf;
+    char header[120];
+
+    if (!PyArg_ParseTuple(args, KSHAKE320_BUFFER, &headerBuf))
+        return NULL;
+    Py_ssize_t headerLen = headerBuf.len;
+    if (headerLen >= 120)
+        memcpy(header, headerBuf.buf, 120);
+    PyBuffer_Release(&headerBuf);
+    if (headerLen < 120) {
+        PyErr_SetString(PyExc_ValueError, "header must be at least 120 bytes long");
+        return NULL;
+    }
+
+    PyObject *future = NULL;
+    uint64_t id = 0;
+    std::shared_ptr<KSHAKE320VerifyPool> pool;
+    KSHAKE320_BEGIN_CRITICAL_SECTION(self);
+    if (AsyncPoW_checkopen(self) && (self->attached || AsyncPoW_attach(self)))
+        future = PyObject_CallMethod(self->loop, "create_future", NULL);
+    if (future != NULL) {
+        id = self->nextId++;
+        PyObject *key = PyLong_FromUnsignedLongLong(id);
+        if (key == NULL || PyDict_SetItem(self->futures, key, future) < 0)
+            Py_CLEAR(future);
+        Py_XDECREF(key);
+    }
+    if (future != NULL)
+        pool = self->pool;
+    KSHAKE320_END_CRITICAL_SECTION();
+    if (future == NULL)
+        return NULL;
+
+    // The reference keeps the pool alive if close() runs meanwhile, in
+    // which case the header is dropped with the pool and the future cancelled
+    Py_BEGIN_ALLOW_THREADS
+    pool->Submit(id, header);
+    pool.reset();
+    Py_END_ALLOW_THREADS
+    return future;
+}
+
+static PyObject *AsyncPoW_drain(AsyncPoWObject *self, PyObject *args)
+{
+    std::vector<KSHAKE320VerifyPool::Completion> completions;
+
+    // Taking the hashes does not wait: the GIL is kept, and with it the pool
+    int open;
+    KSHAKE320_BEGIN_CRITICAL_SECTION(self);
+    open = AsyncPoW_checkopen(self);
+    if (open)
+        self->pool->Take(completions);
+    KSHAKE320_END_CRITICAL_SECTION();
+    if (!open)
+        return NULL;
+
+    // Every completion taken is handled even when one fails, or its future
+    // would never resolve: the first error is raised once all are done, and
+    // the completions whose future could not be looked up are put back.
+    std::vector<KSHAKE320VerifyPool::Completion> failed;
+    PyObject *type = NULL, *value = NULL, *traceback = NULL;
+    for (size_t i = 0; i < completions.size(); i++) {
+        PyObject *key = PyLong_FromUnsignedLongLong(completions[i].id);
+        PyObject *future = key == NULL ? NULL : PyDict_GetItem(self->futures, key);
+        int ok = 1;
+        if (key == NULL) {
+            failed.push_back(completions[i]);
+            ok = 0;
+        }
+        else if (future != NULL) {
+            Py_INCREF(future);
+            ok = PyDict_DelItem(self->futures, key) == 0;
+            // A future cancelled by its caller takes no result
+            PyObject *ret = ok ? PyObject_CallMethod(future, "cancelled", NULL) : NULL;
+            int cancelled = ret == NULL ? -1 : PyObject_IsTrue(ret);
+            Py_XDECREF(ret);
+            if (cancelled == 0) {
+                ret = PyObject_CallMethod(future, "set_result", "y#", (const char *)completions[i].hash.begin(), (Py_ssize_t)40);
+                Py_XDECREF(ret);
+            }
+            ok = cancelled > 0 || (cancelled == 0 && ret != NULL);
+            Py_DECREF(future);
+        }
+        Py_XDECREF(key);
+        if (!ok) {
+            if (type == NULL)
+                PyErr_Fetch(&type, &value, &traceback);
+            else
+                PyErr_Clear();
+        }
+    }
+    if (!failed.empty()) {
+        KSHAKE320_BEGIN_CRITICAL_SECTION(self);
+        if (self->pool)
+            self->pool->Restore(failed);
+        KSHAKE320_END_CRITICAL_SECTION();
+    }
+    if (type != NULL) {
+        PyErr_Restore(type, value, traceback);
+        return NULL;
+    }
+    return PyLong_FromSize_t(completions.size() - failed.size());
+}
+
+static PyObject *AsyncPoW_close(AsyncPoWObject *self, PyObject *args)
+{
+    int ok = 1;
+    KSHAKE320_BEGIN_CRITICAL_SECTION(self);
+    if (self->pool && self->attached) {
+        PyObject *ret = PyObject_CallMethod(self->loop, "remove_reader", "i", self->pool->Fd());
+        ok = ret != NULL;
+        Py_XDECREF(ret);
+        self->attached = !ok;
+    }
+    if (ok)
+        AsyncPoW_stop(self);
+    KSHAKE320_END_CRITICAL_SECTION();
+    if (!ok)
+        return NULL;
+
+    // The futures left will not get a hash
+    PyObject *futures = self->futures;
+    self->futures = PyDict_New();
+    if (futures != NULL) {
+        PyObject *key, *future;
+        Py_ssize_t pos = 0;
+        while (PyDict_Next(futures, &pos, &key, &future)) {
+            PyObject *ret = PyObject_CallMethod(future, "cancel", NULL);
+            Py_XDECREF(ret);
+        }
+        Py_DECREF(futures);
+    }
+    if (PyErr_Occurred())
+        return NULL;
+    Py_RETURN_NONE;
 }
 
-static PyObject *kshake320_gethash256(PyObject *self, PyObject *args)
+static PyObject *AsyncPoW_getthreads(AsyncPoWObject *self, void *closure)
 {
-    char *output;
+    unsigned int threads = 0;
+    KSHAKE320_BEGIN_CRITICAL_SECTION(self);
+    if (AsyncPoW_checkopen(self))
+        threads = self->pool->Threads();
+    KSHAKE320_END_CRITICAL_SECTION();
+    if (threads == 0)
+        return NULL;
+    return PyLong_FromUnsignedLong(threads);
+}
+
+static PyObject *AsyncPoW_getpending(AsyncPoWObject *self, void *closure)
+{
+    return PyLong_FromSsize_t(self->futures == NULL ? 0 : PyDict_Size(self->futures));
+}
+
+static PyMethodDef AsyncPoWMethods[] = {
+    { "hash", (PyCFunction)AsyncPoW_hash, METH_VARARGS, "hash(header) -> asyncio.Future\n"
+        "Queues the pow hash of the first 120 bytes of header and returns a future of the running\n"
+        "event loop, or of the loop given to AsyncPoW, that gets the 40-byte hash" },
+    { "drain", (PyCFunction)AsyncPoW_drain, METH_NOARGS, "drain() -> int\n"
+        "Resolves the futures of the finished hashes and returns how many hashes were finished.\n"
+        "The event loop calls it when the pool signals that hashes are ready" },
+    { "close", (PyCFunction)AsyncPoW_close, METH_NOARGS, "Stops the threads and cancels the pending futures" },
+    { NULL, NULL, 0, NULL }
+};
+
+static PyGetSetDef AsyncPoWGetSet[] = {
+    { (char *)"threads", (getter)AsyncPoW_getthreads, NULL, (char *)"Number of worker threads", NULL },
+    { (char *)"pending", (getter)AsyncPoW_getpending, NULL, (char *)"Number of futures not resolved yet", NULL },
+    { NULL, NULL, NULL, NULL, NULL }
+};
+
+static PyType_Slot AsyncPoWSlots[] = {
+    { Py_tp_dealloc, (void *)AsyncPoW_dealloc },
+    { Py_tp_doc, (void *)"AsyncPoW(threads=0, loop=None)\n"
+        "Pool of threads computing pow hashes for an asyncio event loop, as many as the CPU has when\n"
+        "threads is 0. Headers queued by hash() are hashed several at a time with the SIMD kernels." },
+    { Py_tp_traverse, (void *)AsyncPoW_traverse },
+    { Py_tp_clear, (void *)AsyncPoW_clear },
+    { Py_tp_methods, AsyncPoWMethods },
+    { Py_tp_getset, AsyncPoWGetSet },
+    { Py_tp_new, (void *)AsyncPoW_new },
+    { 0, NULL }
+};
+
+static PyType_Spec AsyncPoWSpec = {
+    "kshake320_hash.AsyncPoW", sizeof(AsyncPoWObject), 0, KSHAKE320_TPFLAGS | Py_TPFLAGS_HAVE_GC, AsyncPoWSlots
+};
+#endif
+
+// Incremental SHAKE320 and SHA3-320, in the style of hashlib. The sponge
+// state lives in the object, so the memory used does not depend on how much
+// data goes through update().
+typedef struct {
+    PyObject_HEAD
+    Keccak_HashInstance *hash;          // storage aligned as the sponge wants it
+    int shake;                          // shake320 rather than sha3_320
+    int squeezing;                      // read() was called, no more update()
+    PyThread_type_lock lock;            // taken by updates done without the GIL
+    char storage[sizeof(Keccak_HashInstance) + 32];
+} KeccakObject;
+
+static KeccakObject *Keccak_alloc(PyTypeObject *type, int shake)
+{
+    KeccakObject *self = (KeccakObject *)type->tp_alloc(type, 0);
+    if (self == NULL)
+        return NULL;
+    self->hash = (Keccak_HashInstance *)(((uintptr_t)self->storage + 31) & ~(uintptr_t)31);
+    self->shake = shake;
+    self->squeezing = 0;
+    self->lock = NULL;
+#ifdef Py_GIL_DISABLED
+    // Without the GIL every update can race with another thread
+    self->lock = PyThread_allocate_lock();
+    if (self->lock == NULL) {
+        Py_DECREF(self);
+        PyErr_NoMemory();
+        return NULL;
+    }
+#endif
+    return self;
+}
+
+static int Keccak_isshake(KeccakObject *self)
+{
+    return self->shake;
+}
+
+static int Keccak_checkupdate(KeccakObject *self)
+{
+    if (self->squeezing) {
+        PyErr_SetString(PyExc_ValueError, "shake320 object already read from");
+        return 0;
+    }
+    return 1;
+}
+
+static int Keccak_absorb(KeccakObject *self, PyObject *dataObj)
+{
+    Py_buffer data;
+    HashReturn result = SUCCESS;
+    int squeezing;
+
+    if (PyObject_GetBuffer(dataObj, &data, PyBUF_SIMPLE) < 0)
+        return 0;
+    if (self->lock == NULL && data.len >= KSHAKE320_GIL_MINSIZE)
+        self->lock = PyThread_allocate_lock();
+    if (self->lock != NULL) {
+        // Other threads may use the object while this one hashes without the
+        // GIL, and a read() may have started squeezing since it was checked.
+        Py_BEGIN_ALLOW_THREADS
+        PyThread_acquire_lock(self->lock, 1);
+        squeezing = self->squeezing;
+        if (!squeezing)
+            result = Keccak_HashUpdate(self->hash, (const BitSequence *)data.buf, (DataLength)data.len * 8);
+        PyThread_release_lock(self->lock);
+        Py_END_ALLOW_THREADS
+    }
+    else {
+        squeezing = self->squeezing;
+        if (!squeezing)
+            result = Keccak_HashUpdate(self->hash, (const BitSequence *)data.buf, (DataLength)data.len * 8);
+    }
+    PyBuffer_Release(&data);
+    if (squeezing)
+        return Keccak_checkupdate(self);
+    if (result != SUCCESS) {
+        PyErr_SetString(PyExc_RuntimeError, "Keccak_HashUpdate failed");
+        return 0;
+    }
+    return 1;
+}
+
+// Copies the state so that the object can be used while it is copied.
+static void Keccak_copystate(KeccakObject *self, Keccak_HashInstance *to)
+{
+    if (self->lock != NULL && !PyThread_acquire_lock(self->lock, 0)) {
+        Py_BEGIN_ALLOW_THREADS
+        PyThread_acquire_lock(self->lock, 1);
+        Py_END_ALLOW_THREADS
+        memcpy(to, self->hash, sizeof(Keccak_HashInstance));
+        PyThread_release_lock(self->lock);
+    }
+    else {
+        memcpy(to, self->hash, sizeof(Keccak_HashInstance));
+        if (self->lock != NULL)
+            PyThread_release_lock(self->lock);
+    }
+}
+
+static PyObject *Keccak_new(PyTypeObject *type, PyObject *args, PyObject *kwds, int shake)
+{
+    static char *kwlist[] = { (char *)"data", NULL };
+    PyObject *data = NULL;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O", kwlist, &data))
+        return NULL;
+    KeccakObject *self = Keccak_alloc(type, shake);
+    if (self == NULL)
+        return NULL;
+    if (shake)
+        Keccak_HashInitialize(self->hash, SHAKE320_R, SHAKE320_C, 0, SHAKE320_P);
+    else
+        Keccak_HashInitialize(self->hash, SHA3_320_R, SHA3_320_C, SHA3_320_L, SHA3_320_P);
+    if (data != NULL && !Keccak_absorb(self, data)) {
+        Py_DECREF(self);
+        return NULL;
+    }
+    return (PyObject *)self;
+}
+
+static PyObject *SHAKE320_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    return Keccak_new(type, args, kwds, 1);
+}
+
+static PyObject *SHA3_320_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    return Keccak_new(type, args, kwds, 0);
+}
+
+static void Keccak_dealloc(KeccakObject *self)
+{
+    if (self->lock != NULL)
+        PyThread_free_lock(self->lock);
+    kshake320_free((PyObject *)self);
+}
+
+static PyObject *Keccak_update(KeccakObject *self, PyObject *data)
+{
+    if (!Keccak_absorb(self, data))
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyObject *Keccak_copy(KeccakObject *self, PyObject *args)
+{
+    KeccakObject *copy = Keccak_alloc(Py_TYPE(self), self->shake);
+    if (copy == NULL)
+        return NULL;
+    Keccak_copystate(self, copy->hash);
+    copy->squeezing = self->squeezing;
+    return (PyObject *)copy;
+}
+
+// Writes the digest of the data absorbed so far, leaving the object as it is.
+// length is ignored for sha3_320, whose digest is 40 bytes.
+static PyObject *Keccak_final(KeccakObject *self, PyObject *args, int hex)
+{
+    Py_ssize_t length = SHA3_320_DL;
+    unsigned char storage[sizeof(Keccak_HashInstance) + 32];
+    Keccak_HashInstance *hash = (Keccak_HashInstance *)(((uintptr_t)storage + 31) & ~(uintptr_t)31);
     PyObject *value;
+
+    if (Keccak_isshake(self)) {
+        if (!PyArg_ParseTuple(args, hex ? "n:hexdigest" : "n:digest", &length))
+            return NULL;
+        if (length < 0) {
+            PyErr_SetString(PyExc_ValueError, "length must not be negative");
+            return NULL;
+        }
+    }
+    if (!Keccak_checkupdate(self))
+        return NULL;
+    Keccak_copystate(self, hash);
+    value = PyBytes_FromStringAndSize(NULL, length);
+    if (value == NULL)
+        return NULL;
+    unsigned char *md = (unsigned char *)PyBytes_AS_STRING(value);
+    if (Keccak_isshake(self)) {
+        Keccak_HashFinal(hash, NULL);
+        Keccak_HashSqueeze(hash, md, (DataLength)length * 8);
+    }
+    else
+        Keccak_HashFinal(hash, md);
+    if (!hex)
+        return value;
+
+    static const char digits[] = "0123456789abcdef";
+    std::vector<char> text((size_t)length * 2);
+    for (Py_ssize_t i = 0; i < length; i++) {
+        text[2 * i] = digits[md[i] >> 4];
+        text[2 * i + 1] = digits[md[i] & 15];
+    }
+    Py_DECREF(value);
 #if PY_MAJOR_VERSION >= 3
-    PyBytesObject *input;
+    return PyUnicode_FromStringAndSize(text.data(), length * 2);
 #else
-    PyStringObject *input;
+    return PyString_FromStringAndSize(text.data(), length * 2);
 #endif
-    if (!PyArg_ParseTuple(args, "S", &input))
+}
+
+static PyObject *Keccak_digest(KeccakObject *self, PyObject *args)
+{
+    return Keccak_final(self, args, 0);
+}
+
+static PyObject *Keccak_hexdigest(KeccakObject *self, PyObject *args)
+{
+    return Keccak_final(self, args, 1);
+}
+
+// Squeezes the next length bytes of the SHAKE320 output, after which the
+// object takes no more data.
+static PyObject *Keccak_read(KeccakObject *self, PyObject *args)
+{
+    Py_ssize_t length;
+
+    if (!PyArg_ParseTuple(args, "n:read", &length))
         return NULL;
-    Py_INCREF(input);
-    output = (char*)PyMem_Malloc(32);
+    if (length < 0) {
+        PyErr_SetString(PyExc_ValueError, "length must not be negative");
+        return NULL;
+    }
+    PyObject *value = PyBytes_FromStringAndSize(NULL, length);
+    if (value == NULL)
+        return NULL;
+    if (self->lock != NULL) {
+        Py_BEGIN_ALLOW_THREADS
+        PyThread_acquire_lock(self->lock, 1);
+        Py_END_ALLOW_THREADS
+    }
+    if (!self->squeezing) {
+        Keccak_HashFinal(self->hash, NULL);
+        self->squeezing = 1;
+    }
+    Keccak_HashSqueeze(self->hash, (BitSequence *)PyBytes_AS_STRING(value), (DataLength)length * 8);
+    if (self->lock != NULL)
+        PyThread_release_lock(self->lock);
+    return value;
+}
 
+static PyObject *Keccak_getname(KeccakObject *self, void *closure)
+{
+    const char *name = Keccak_isshake(self) ? "shake320" : "sha3_320";
 #if PY_MAJOR_VERSION >= 3
-    GetHash256((char *)PyBytes_AsString((PyObject*) input), Py_SIZE((PyObject*) input), output);
+    return PyUnicode_FromString(name);
 #else
-    GetHash256((char *)PyString_AsString((PyObject*) input), Py_SIZE((PyObject*) input), output);
+    return PyString_FromString(name);
 #endif
-    Py_DECREF(input);
+}
+
+static PyObject *Keccak_getdigestsize(KeccakObject *self, void *closure)
+{
+    return PyLong_FromLong(Keccak_isshake(self) ? 0 : SHA3_320_DL);
+}
+
+static PyObject *Keccak_getblocksize(KeccakObject *self, void *closure)
+{
+    return PyLong_FromLong(SHA3_320_R / 8);
+}
+
+static PyMethodDef SHA3_320Methods[] = {
+    { "update", (PyCFunction)Keccak_update, METH_O, "update(data)\nAbsorbs data, any bytes-like object" },
+    { "copy", (PyCFunction)Keccak_copy, METH_NOARGS, "Returns a copy of the object, sharing none of its state" },
+    { "digest", (PyCFunction)Keccak_digest, METH_NOARGS, "Returns the 40-byte digest of the data absorbed so far" },
+    { "hexdigest", (PyCFunction)Keccak_hexdigest, METH_NOARGS, "Returns digest() as a string of hexadecimal digits" },
+    { NULL, NULL, 0, NULL }
+};
+
+static PyMethodDef SHAKE320Methods[] = {
+    { "update", (PyCFunction)Keccak_update, METH_O, "update(data)\nAbsorbs data, any bytes-like object" },
+    { "copy", (PyCFunction)Keccak_copy, METH_NOARGS, "Returns a copy of the object, sharing none of its state" },
+    { "digest", (PyCFunction)Keccak_digest, METH_VARARGS, "digest(length) -> bytes\n"
+        "Returns the first length bytes of the output for the data absorbed so far" },
+    { "hexdigest", (PyCFunction)Keccak_hexdigest, METH_VARARGS, "hexdigest(length) -> str\n"
+        "Returns digest(length) as a string of hexadecimal digits" },
+    { "read", (PyCFunction)Keccak_read, METH_VARARGS, "read(length) -> bytes\n"
+        "Returns the next length bytes of the output. update(), digest() and hexdigest()\n"
+        "are not allowed after the first read()" },
+    { NULL, NULL, 0, NULL }
+};
+
+static PyGetSetDef KeccakGetSet[] = {
+    { (char *)"name", (getter)Keccak_getname, NULL, NULL, NULL },
+    { (char *)"digest_size", (getter)Keccak_getdigestsize, NULL, (char *)"Digest length in bytes, 0 for shake320", NULL },
+    { (char *)"block_size", (getter)Keccak_getblocksize, NULL, (char *)"Rate of the sponge in bytes", NULL },
+    { NULL, NULL, NULL, NULL, NULL }
+};
+
+static PyType_Slot SHAKE320Slots[] = {
+    { Py_tp_dealloc, (void *)Keccak_dealloc },
+    { Py_tp_doc, (void *)"shake320(data=b'')\n"
+        "Incremental SHAKE320, the extendable-output function behind getHash320." },
+    { Py_tp_methods, SHAKE320Methods },
+    { Py_tp_getset, KeccakGetSet },
+    { Py_tp_new, (void *)SHAKE320_new },
+    { 0, NULL }
+};
+
+static PyType_Spec SHAKE320Spec = {
+    "kshake320_hash.shake320", sizeof(KeccakObject), 0, KSHAKE320_TPFLAGS, SHAKE320Slots
+};
+
+static PyType_Slot SHA3_320Slots[] = {
+    { Py_tp_dealloc, (void *)Keccak_dealloc },
+    { Py_tp_doc, (void *)"sha3_320(data=b'')\n"
+        "Incremental SHA3-320, with a 40-byte digest." },
+    { Py_tp_methods, SHA3_320Methods },
+    { Py_tp_getset, KeccakGetSet },
+    { Py_tp_new, (void *)SHA3_320_new },
+    { 0, NULL }
+};
+
+static PyType_Spec SHA3_320Spec = {
+    "kshake320_hash.sha3_320", sizeof(KeccakObject), 0, KSHAKE320_TPFLAGS, SHA3_320Slots
+};
+
+static PyObject *kshake320_getbackend(PyObject *self, PyObject *args)
+{
+    const char *name = kshake320_backend();
 #if PY_MAJOR_VERSION >= 3
-    value = Py_BuildValue("y#", output, 32);
+    return PyUnicode_FromString(name);
 #else
-    value = Py_BuildValue("s#", output, 32);
+    return PyString_FromString(name);
 #endif
-    PyMem_Free(output);
-    return value;
+}
+
+// Adds value, a new reference or NULL, to dict under key.
+static int kshake320_setitem(PyObject *dict, const char *key, PyObject *value)
+{
+    if (value == NULL)
+        return -1;
+    int result = PyDict_SetItemString(dict, key, value);
+    Py_DECREF(value);
+    return result;
+}
+
+static PyObject *kshake320_stats(PyObject *self, PyObject *args)
+{
+    KSHAKE320PhaseStats stats[KSHAKE320_PHASE_COUNT];
+    bool available[KSHAKE320_COUNTER_COUNT];
+    if (!KSHAKE320PerfStats(stats, available))
+        Py_RETURN_NONE;
+
+    PyObject *result = PyDict_New();
+    if (result == NULL)
+        return NULL;
+    for (int p = 0; p < KSHAKE320_PHASE_COUNT; p++) {
+        PyObject *phase = PyDict_New();
+        if (kshake320_setitem(result, KSHAKE320PhaseName(p), phase) < 0
+            || kshake320_setitem(phase, "hashes", PyLong_FromUnsignedLongLong(stats[p].hashes)) < 0) {
+            Py_DECREF(result);
+            return NULL;
+        }
+        for (int c = 0; c < KSHAKE320_COUNTER_COUNT; c++) {
+            PyObject *value = Py_None;
+            if (available[c])
+                value = PyLong_FromUnsignedLongLong(stats[p].counters[c]);
+            else
+                Py_INCREF(value);
+            if (kshake320_setitem(phase, KSHAKE320CounterName(c), value) < 0) {
+                Py_DECREF(result);
+                return NULL;
+            }
+        }
+    }
+    return result;
+}
+
+static PyObject *kshake320_metrics(PyObject *self, PyObject *args)
+{
+    KSHAKE320Metrics::Totals totals;
+    double ticksPerSecond;
+    Py_BEGIN_ALLOW_THREADS
+    KSHAKE320Metrics::Read(totals);
+    ticksPerSecond = KSHAKE320Metrics::TicksPerSecond();
+    Py_END_ALLOW_THREADS
+
+    // Each new object goes into its container at once, which then owns it
+    PyObject *result = PyDict_New(), *pow, *entries;
+    if (result == NULL)
+        return NULL;
+    if (kshake320_setitem(result, "ticks_per_second", PyFloat_FromDouble(ticksPerSecond)) < 0
+        || kshake320_setitem(result, "pow_hashes", pow = PyDict_New()) < 0
+        || kshake320_setitem(pow, "v1", PyLong_FromUnsignedLongLong(totals.powHashes[0])) < 0
+        || kshake320_setitem(pow, "v2", PyLong_FromUnsignedLongLong(totals.powHashes[1])) < 0
+        || kshake320_setitem(result, "entries", entries = PyDict_New()) < 0) {
+        Py_DECREF(result);
+        return NULL;
+    }
+    for (int i = 0; i < KSHAKE320Metrics::ENTRY_COUNT; i++) {
+        const KSHAKE320Metrics::EntryTotals &e = totals.entries[i];
+        PyObject *entry, *latency;
+        if (kshake320_setitem(entries, KSHAKE320Metrics::EntryName(i), entry = PyDict_New()) < 0
+            || kshake320_setitem(entry, "calls", PyLong_FromUnsignedLongLong(e.calls)) < 0
+            || kshake320_setitem(entry, "bytes", PyLong_FromUnsignedLongLong(e.bytes)) < 0
+            || kshake320_setitem(entry, "ticks", PyLong_FromUnsignedLongLong(e.ticks)) < 0
+            || kshake320_setitem(entry, "latency", latency = PyList_New(KSHAKE320Metrics::LATENCY_BUCKETS)) < 0) {
+            Py_DECREF(result);
+            return NULL;
+        }
+        for (int b = 0; b < KSHAKE320Metrics::LATENCY_BUCKETS; b++) {
+            PyObject *count = PyLong_FromUnsignedLongLong(e.latency[b]);
+            if (count == NULL) {
+                Py_DECREF(result);
+                return NULL;
+            }
+            PyList_SET_ITEM(latency, b, count);
+        }
+    }
+    return result;
+}
+
+static PyObject *kshake320_resetmetrics(PyObject *self, PyObject *args)
+{
+    KSHAKE320Metrics::Reset();
+    Py_RETURN_NONE;
+}
+
+// Selects the Keccak backend when the module is first loaded. The backend is
+// shared by all the interpreters of the process and never changes afterwards.
+static int kshake320_initbackend(void)
+{
+    // Only the first interpreter warns
+    static std::once_flag once;
+    int failed = 0;
+    std::call_once(once, [&failed] { failed = kshake320_init(); });
+    if (failed)
+        return PyErr_WarnEx(PyExc_RuntimeWarning, "KSHAKE320_BACKEND or KSHAKE320_SHA256"
+            " names an unknown or unsupported implementation, using the detected one", 1);
+    return 0;
+}
+
+// Creates the types and adds them to the module, returning -1 on failure.
+static int kshake320_addtypes(PyObject *module)
+{
+    PyType_Spec *specs[] = {
+        &NonceSearcherSpec,
+        &PowJobSpec,
+#if KSHAKE320_ASYNC
+        &AsyncPoWSpec,
+#endif
+        &SHAKE320Spec,
+        &SHA3_320Spec,
+    };
+    for (size_t i = 0; i < sizeof(specs) / sizeof(specs[0]); i++) {
+        PyObject *type = kshake320_typefromspec(module, specs[i]);
+        if (type == NULL)
+            return -1;
+        // The attribute is the name after the module's
+        if (PyModule_AddObject(module, strchr(specs[i]->name, '.') + 1, type) < 0) {
+            Py_DECREF(type);
+            return -1;
+        }
+    }
+    return 0;
 }
 
 static PyMethodDef KSHAKE320Methods[] = {
-    { "getPoWHash", kshake320_getpowhash, METH_VARARGS, "Returns the kshake320 pow hash" },
-    { "getHash320", kshake320_gethash320, METH_VARARGS, "Returns the kshake320 hash 320" },
-    { "getHash256", kshake320_gethash256, METH_VARARGS, "Returns the kshake320 hash 256" },
+    { "getPoWHash", (PyCFunction)(void (*)(void))kshake320_getpowhash, KSHAKE320_CALL_FLAGS, "getPoWHash(header, out=None)\n"
+        "Returns the kshake320 pow hash of the first 120 bytes of header, any bytes-like object.\n"
+        "With out, a writable buffer of at least 40 bytes, the hash is written there and out is returned" },
+    { "getPoWHashBatch", (PyCFunction)(void (*)(void))kshake320_getpowhashbatch, METH_VARARGS | METH_KEYWORDS, "getPoWHashBatch(headers, count, out=None) -> bytes\n"
+        "Returns the count pow hashes, 40 bytes each, of the count 120-byte headers stored one after the other\n"
+        "in headers (bytes, bytearray, memoryview...). Hashes several headers at once with AVX2 or AVX-512.\n"
+        "With out, a writable buffer of at least count * 40 bytes not overlapping headers, the hashes are\n"
+        "written there and out is returned; an out overlapping headers raises ValueError" },
+    { "getPoWHashArray", (PyCFunction)(void (*)(void))kshake320_getpowhasharray, METH_VARARGS | METH_KEYWORDS, "getPoWHashArray(headers, out, threads=1) -> out\n"
+        "Writes the pow hashes of the rows of headers, a C-contiguous (n, 120) array of bytes such as a\n"
+        "numpy uint8 array, to the rows of out, a writable C-contiguous (n, 40) array of bytes.\n"
+        "The rows are split between threads threads, as many as the CPU has when threads is 0,\n"
+        "and hashed several at once with AVX2 or AVX-512. out must not overlap headers" },
+    { "getHash320", (PyCFunction)(void (*)(void))kshake320_gethash320, KSHAKE320_CALL_FLAGS, "getHash320(data, out=None)\n"
+        "Returns the kshake320 hash 320 of data, any bytes-like object, or writes it to the 40-byte out" },
+    { "getHash256", (PyCFunction)(void (*)(void))kshake320_gethash256, KSHAKE320_CALL_FLAGS, "getHash256(data, out=None)\n"
+        "Returns the kshake320 hash 256 of data, any bytes-like object, or writes it to the 32-byte out" },
+    { "getSHA256d", (PyCFunction)(void (*)(void))kshake320_getsha256d, KSHAKE320_CALL_FLAGS, "getSHA256d(data, out=None)\n"
+        "Returns the SHA-256 of the SHA-256 of data, or writes it to the 32-byte out" },
+    { "getHash160", (PyCFunction)(void (*)(void))kshake320_gethash160, KSHAKE320_CALL_FLAGS, "getHash160(data, out=None)\n"
+        "Returns the RIPEMD-160 of the SHA-256 of data, or writes it to the 20-byte out" },
+    { "scan", kshake320_scan, METH_VARARGS, "scan(header, nonce_offset, start, count, target) -> [(nonce, hash), ...]\n"
+        "Hashes header for count nonces from start, written as uint32 little-endian at nonce_offset,\n"
+        "and returns those whose pow hash, read as a little-endian uint320, does not exceed target" },
+    { "getBackend", kshake320_getbackend, METH_NOARGS, "Returns the name of the Keccak backend in use" },
+    { "metrics", kshake320_metrics, METH_NOARGS, "metrics() -> dict\n"
+        "Returns the counts of the calls since the module was loaded or reset_metrics() was called,\n"
+        "for all threads and interpreters: pow_hashes, the v1 and v2 headers hashed by all the\n"
+        "functions and by the threads of NonceSearcher and AsyncPoW, and entries, by function, its\n"
+        "calls, the bytes it hashed, the ticks it spent hashing and latency, the number of calls\n"
+        "that took 0 ticks then 1, 2-3, 4-7... ticks.\n"
+        "ticks_per_second converts ticks, which are those of the time-stamp counter on x86" },
+    { "reset_metrics", kshake320_resetmetrics, METH_NOARGS, "reset_metrics()\n"
+        "Sets the counts returned by metrics() back to zero" },
+    { "stats", kshake320_stats, METH_NOARGS, "stats() -> {phase: {counter: total, ...}, ...} or None\n"
+        "Returns the totals of the hardware counters over each phase of the pow, from v1_absorb to\n"
+        "v2_final_squeeze, for all threads, with hashes the number of headers through the phase.\n"
+        "A counter the CPU or the kernel does not provide is None. Returns None unless the module\n"
+        "was built with KSHAKE320_PERF_COUNTERS" },
     { NULL, NULL, 0, NULL }
 };
 
+static int kshake320_exec(PyObject *module)
+{
+    if (kshake320_addtypes(module) < 0 || kshake320_initbackend() < 0)
+        return -1;
+    KSHAKE320Metrics::Start();
+    return 0;
+}
+
+#if PY_VERSION_HEX >= 0x03050000
+// Multi-phase init: every interpreter importing the module gets its own
+// module object and types. What the interpreters and threads share is
+// process-wide and safe to use from any of them: the Keccak and SHA-256
+// backends, chosen once under std::call_once and only read afterwards, and
+// the metrics, whose counters are atomics in blocks of their own for each
+// thread, with the baseline of reset_metrics() under a mutex. The module
+// does not declare Py_mod_gil yet: free-threaded builds re-enable the GIL
+// when it is imported until it has been tested without the GIL.
+static PyModuleDef_Slot KSHAKE320Slots[] = {
+    { Py_mod_exec, (void *)kshake320_exec },
+#if PY_VERSION_HEX >= 0x030C0000
+    { Py_mod_multiple_interpreters, Py_MOD_PER_INTERPRETER_GIL_SUPPORTED },
+#endif
+    { 0, NULL }
+};
+#endif
+
 #if PY_MAJOR_VERSION >= 3
 static struct PyModuleDef KSHAKE320Module = {
     PyModuleDef_HEAD_INIT,
     "kshake320_hash",
     "...",
+#if PY_VERSION_HEX >= 0x03050000
+    0,
+    KSHAKE320Methods,
+    KSHAKE320Slots
+#else
     -1,
     KSHAKE320Methods
+#endif
 };
 
 PyMODINIT_FUNC PyInit_kshake320_hash(void) {
-    return PyModule_Create(&KSHAKE320Module);
+#if PY_VERSION_HEX < 0x03070000
+    // NonceSearcher threads take the GIL to call back
+    PyEval_InitThreads();
+#endif
+#if PY_VERSION_HEX >= 0x03050000
+    return PyModuleDef_Init(&KSHAKE320Module);
+#else
+    PyObject *module = PyModule_Create(&KSHAKE320Module);
+    if (module == NULL)
+        return NULL;
+    if (kshake320_exec(module) < 0) {
+        Py_DECREF(module);
+        return NULL;
+    }
+    return module;
+#endif
 }
 
 #else
 
 PyMODINIT_FUNC initkshake320_hash(void) {
-    (void) Py_InitModule("kshake320_hash", KSHAKE320Methods);
+    // NonceSearcher threads take the GIL to call back
+    PyEval_InitThreads();
+    PyObject *module = Py_InitModule("kshake320_hash", KSHAKE320Methods);
+    if (module == NULL)
+        return;
+    kshake320_exec(module);
 }
 #endif
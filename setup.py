@@ -1,16 +1,67 @@
+import os
+import platform
 from distutils.core import setup, Extension
+from distutils.command.build_ext import build_ext
+
+# libkshake320: the PoW and hashes with a C interface (kshake320/kshake320.h),
+# for native programs as well as this module.
+lib_sources = [
+    'kshake320/pow.cpp',
+    'kshake320/kshake320.cpp',
+    'kshake320/perf.cpp',
+    'crypto/sha256.c',
+    'crypto/sha256-shani.c',
+    'crypto/ripemd160.c',
+    'keccak/sha3.c',
+    'keccak/KeccakHash.c',
+    'keccak/KeccakRnd.c',
+    'keccak/KeccakSponge.c',
+    'keccak/KeccakF-1600/Optimized64/KeccakF-1600-opt64.c',
+    'keccak/SnP/SnP-FBWL-default.c',
+]
+define_macros = []
+
+# On x86-64 the AVX2 and AVX-512 kernels are always built and the
+# Keccak backend is chosen at run time (see keccak/KeccakF-1600/Dispatch).
+if platform.machine().lower() in ('x86_64', 'amd64'):
+    lib_sources += [
+        'keccak/KeccakSpongeTimes4.c',
+        'keccak/KeccakSpongeTimes8.c',
+        'keccak/KeccakF-1600/Dispatch/KeccakF-1600-dispatch.c',
+        'keccak/KeccakF-1600/Optimized64/KeccakF-1600-opt64-AVX2.c',
+        'keccak/KeccakF-1600/SIMD256/KeccakF-1600-times4-SIMD256.c',
+        'keccak/KeccakF-1600/AVX512/KeccakF-1600-times8-AVX512.c',
+    ]
+    define_macros += [('USE_KECCAK_DISPATCH', None)]
+
+# Setting KSHAKE320_V2_CHECKPOINT_INTERVAL=k at build time makes the v2 PoW
+# keep one sponge state every k blocks instead of a 64 KiB scratchpad,
+# e.g. under 9 KiB at k=22, for up to twice the squeezing work.
+checkpoint_interval = os.environ.get('KSHAKE320_V2_CHECKPOINT_INTERVAL')
+if checkpoint_interval:
+    define_macros += [('KSHAKE320_V2_CHECKPOINT_INTERVAL', str(int(checkpoint_interval)))]
+
+# Setting KSHAKE320_PERF_COUNTERS=1 at build time (Linux only) counts the
+# cycles, instructions and cache misses of each phase of the PoW, which
+# kshake320_hash.stats() returns.
+if os.environ.get('KSHAKE320_PERF_COUNTERS', '0') != '0':
+    define_macros += [('KSHAKE320_PERF_COUNTERS', None)]
+
+
+# build_ext links the libraries of build_clib but does not build them,
+# which "setup.py build_ext --inplace" relies on.
+class build_ext_with_clib(build_ext):
+    def run(self):
+        self.run_command('build_clib')
+        build_ext.run(self)
+
 
 kshake320_hash = Extension('kshake320_hash',
-    sources = [
-        'kshake320hashmodule.cpp',
-        'keccak/sha3.c',
-        'keccak/KeccakHash.c',
-        'keccak/KeccakRnd.c',
-        'keccak/KeccakSponge.c',
-        'keccak/KeccakF-1600/Optimized64/KeccakF-1600-opt64.c',
-        'keccak/SnP/SnP-FBWL-default.c',
-    ])
+    sources = ['kshake320hashmodule.cpp'],
+    define_macros = define_macros)
 
 setup (name = 'kshake320_hash',
     version = '1.0',
+    libraries = [('kshake320', {'sources': lib_sources, 'macros': define_macros})],
+    cmdclass = {'build_ext': build_ext_with_clib},
     ext_modules = [kshake320_hash])
@@ -1,24 +1,370 @@
-def _test():       
+from __future__ import print_function
+
+def _test():
     header_bin = binascii.unhexlify('0100000000000000cb43b0ec8ef4464f3d041493689274ee53741586acf0ad0b94b0d0986928165fd9823edff8000000917e5ee9f277da18cb60d7a3b3bf5cb3edf82a559f63de9ab5684405e382b69205139b983ea68fb20000000000000000000000000000000000000000ffff0026179cfb0343ff14000000000000000000')
 
     hash_bin = kshake320_hash.getPoWHash(header_bin)
     hash_int = uint320_from_str(hash_bin)
-    print hash_int # 93738456153034120650016320092685904102166196045943475033169329722660916102004727975353821
+    print(hash_int) # 93738456153034120650016320092685904102166196045943475033169329722660916102004727975353821
+    assert hash_int == 93738456153034120650016320092685904102166196045943475033169329722660916102004727975353821
+
+    block_hash_hex = binascii.hexlify(hash_bin[::-1]).decode('ascii')
+    print(block_hash_hex) # 000000bc7c68fee7eec119a78c2aeb0a4a53721ac6f3ad130d3016cf6567c4ffd3bc0a4bd8b19ddd
+    assert block_hash_hex == '000000bc7c68fee7eec119a78c2aeb0a4a53721ac6f3ad130d3016cf6567c4ffd3bc0a4bd8b19ddd'
+
+    _test_scan(header_bin)
+    _test_batch(header_bin)
+    _test_incremental(header_bin)
+    _test_bitcoin_hashes()
+    _test_stats(header_bin)
+    _test_metrics(header_bin)
+    _test_threads(header_bin)
+    _test_subinterpreter(header_bin)
+
+def _test_scan(header_bin):
+    # The nonce is the uint32 at offset 116; the test header has nonce 0
+    nonce_offset = 116
+    start = 0x12345670
+    count = 64
+
+    hashes = []
+    for nonce in range(start, start + count):
+        header = header_bin[:nonce_offset] + struct.pack("<I", nonce) + header_bin[nonce_offset + 4:]
+        hashes.append((nonce, kshake320_hash.getPoWHash(header)))
+
+    # Target set to the median hash: about half of the nonces win, the median included
+    target = sorted(uint320_from_str(h) for n, h in hashes)[count // 2]
+    expected = [(n, h) for n, h in hashes if uint320_from_str(h) <= target]
+    found = kshake320_hash.scan(header_bin, nonce_offset, start, count, target)
+    assert [(n, bytes(h)) for n, h in found] == expected, "scan does not match getPoWHash"
+    assert kshake320_hash.scan(header_bin, nonce_offset, start, count, uint320_to_str(target)) == found
+
+    assert kshake320_hash.scan(header_bin, nonce_offset, start, count, 0) == []
+    assert len(kshake320_hash.scan(header_bin, nonce_offset, start, count, (1 << 320) - 1)) == count
+    print('scan OK')
+
+    _test_searcher(header_bin, nonce_offset, start, count, target, expected)
+    _test_powjob(header_bin, nonce_offset, start, count, target, expected)
+
+def _test_searcher(header_bin, nonce_offset, start, count, target, expected):
+    searcher = kshake320_hash.NonceSearcher(threads=3, chunk_size=5)
+    found = searcher.search(header_bin, nonce_offset, start, count, target, stop_on_first=False)
+    assert [(n, bytes(h)) for n, h in found] == expected, "NonceSearcher does not match getPoWHash"
+    first = searcher.search(header_bin, nonce_offset, start, count, target)
+    assert len(first) >= 1 and (first[0][0], bytes(first[0][1])) in expected
+
+    done = []
+    searcher.submit(header_bin, nonce_offset, 0, 1 << 32, 0, lambda status, results: done.append(status))
+    searcher.cancel()
+    searcher.wait()
+    searcher.close()
+    assert done == ['cancelled']
+
+    # Closing or dropping the searcher from its own callback
+    import threading
+    for drop in (False, True):
+        ended = threading.Event()
+        searcher = kshake320_hash.NonceSearcher(threads=2)
+        def callback(status, results, holder=[searcher]):
+            if drop:
+                holder.pop()
+            else:
+                holder[0].close()
+            ended.set()
+        searcher.submit(header_bin, nonce_offset, start, count, target, callback)
+        del searcher, callback
+        assert ended.wait(60)
+
+    # Closing from another thread cancels a search under way
+    searcher = kshake320_hash.NonceSearcher(threads=2)
+    results = []
+    thread = threading.Thread(target=lambda s=searcher: results.append(s.search(header_bin, nonce_offset, 0, 1 << 32, 0)))
+    thread.start()
+    time.sleep(0.1)
+    searcher.close()
+    thread.join(60)
+    assert results == [[]]
+    try:
+        searcher.threads
+        assert False, "a closed NonceSearcher has no threads"
+    except ValueError:
+        pass
+    print('NonceSearcher OK')
+
+def _test_powjob(header_bin, nonce_offset, start, count, target, expected):
+    job = kshake320_hash.PowJob(header_bin, nonce_offset)
+    assert job.version == 1 and job.nonce_offset == nonce_offset
+    assert [(n, job.hash(n)) for n, h in expected] == expected
+    assert job.scan(start, count, target) == kshake320_hash.scan(header_bin, nonce_offset, start, count, target)
+
+    # Nonce anywhere in a v2 header
+    header_v2 = struct.pack("<i", 2) + header_bin[4:]
+    job = kshake320_hash.PowJob(bytearray(header_v2), nonce_offset=40)
+    out = bytearray(40)
+    assert job.hash(7, out=out) is out and job.version == 2
+    assert bytes(out) == kshake320_hash.getPoWHash(header_v2[:40] + struct.pack("<I", 7) + header_v2[44:])
+
+    # Nonce over the version, which then is v1 or v2 depending on the nonce
+    searcher = kshake320_hash.NonceSearcher(threads=2)
+    for offset, nonces in ((0, (0, 1, 2, 3)), (2, (0, 1, 0x8000, 0xffffffff))):
+        job = kshake320_hash.PowJob(header_bin, offset)
+        for nonce in nonces:
+            expected_hash = kshake320_hash.getPoWHash(header_bin[:offset] + struct.pack("<I", nonce) + header_bin[offset + 4:])
+            assert job.hash(nonce) == expected_hash, (offset, nonce)
+            for found in (job.scan(nonce, 1, (1 << 320) - 1), kshake320_hash.scan(header_bin, offset, nonce, 1, (1 << 320) - 1),
+                          searcher.search(header_bin, offset, nonce, 1, (1 << 320) - 1)):
+                assert [(n, bytes(h)) for n, h in found] == [(nonce, expected_hash)], (offset, nonce)
+    searcher.close()
+    print('PowJob OK')
+
+def _test_batch(header_bin):
+    # v1 and v2 headers mixed, in a number that does not fill the SIMD lanes
+    headers = [struct.pack("<i", 1 + i % 2) + header_bin[4:116] + struct.pack("<I", i) for i in range(11)]
+    expected = b''.join(kshake320_hash.getPoWHash(h) for h in headers)
+    assert kshake320_hash.getPoWHashBatch(b''.join(headers), len(headers)) == expected
+    assert kshake320_hash.getPoWHashBatch(bytearray(b''.join(headers)), len(headers)) == expected
+    assert kshake320_hash.getPoWHashBatch(b'', 0) == b''
+
+    out = bytearray(len(expected) + 1)
+    assert kshake320_hash.getPoWHashBatch(memoryview(b''.join(headers)), len(headers), out=out) is out
+    assert bytes(out[:len(expected)]) == expected
+    out = bytearray(40)
+    kshake320_hash.getPoWHash(bytearray(headers[0]), out=out)
+    assert bytes(out) == expected[:40]
+    shared = bytearray(b''.join(headers))
+    for view in (shared, memoryview(shared)[len(shared) - len(expected):]):
+        try:
+            kshake320_hash.getPoWHashBatch(shared, len(headers), out=view)
+            assert False, "getPoWHashBatch writes over its headers"
+        except ValueError:
+            pass
+    assert shared == b''.join(headers)
+    print('getPoWHashBatch OK')
 
-    block_hash_hex = hash_bin[::-1].encode('hex_codec')    
-    print block_hash_hex # 000000bc7c68fee7eec119a78c2aeb0a4a53721ac6f3ad130d3016cf6567c4ffd3bc0a4bd8b19ddd
+    _test_array(headers, expected)
+    _test_async(headers, expected)
+
+def _test_array(headers, expected):
+    # 2-D arrays as exported by numpy, here made with memoryview.cast
+    try:
+        array = memoryview(b''.join(headers)).cast('B', (len(headers), 120))
+    except (AttributeError, TypeError):
+        return
+    out = bytearray(len(expected))
+    for threads in (1, 3, 0):
+        out[:] = b'\0' * len(out)
+        kshake320_hash.getPoWHashArray(array, memoryview(out).cast('B', (len(headers), 40)), threads=threads)
+        assert bytes(out) == expected
+    try:
+        kshake320_hash.getPoWHashArray(array, memoryview(out[40:]).cast('B', (len(headers) - 1, 40)))
+        assert False, "getPoWHashArray takes an out array with fewer rows"
+    except ValueError:
+        pass
+    shared = bytearray(b''.join(headers))
+    try:
+        kshake320_hash.getPoWHashArray(memoryview(shared).cast('B', (len(headers), 120)),
+                                       memoryview(shared)[:len(expected)].cast('B', (len(headers), 40)), threads=3)
+        assert False, "getPoWHashArray writes over its headers"
+    except ValueError:
+        pass
+    print('getPoWHashArray OK')
+
+def _test_async(headers, expected):
+    if not hasattr(kshake320_hash, 'AsyncPoW'):
+        return
+    import asyncio
+    loop = asyncio.new_event_loop()
+    pool = kshake320_hash.AsyncPoW(threads=2, loop=loop)
+    kshake320_hash.reset_metrics()
+    futures = [pool.hash(h) for h in headers]
+    futures[0].cancel()
+    hashes = loop.run_until_complete(asyncio.gather(*futures[1:]))
+    assert b''.join(hashes) == expected[40:]
+    assert sum(kshake320_hash.metrics()['pow_hashes'].values()) >= len(headers) - 1
+    pending = pool.hash(headers[0])
+    pool.close()
+    assert pending.cancelled() and pool.pending == 0
+
+    # A future that fails to take its hash does not keep the others waiting
+    pool = kshake320_hash.AsyncPoW(threads=1, loop=loop)
+    futures = [pool.hash(h) for h in headers]
+    futures[0].set_result(b'')
+    errors = 0
+    deadline = time.time() + 60
+    while not all(f.done() for f in futures) or pool.pending:
+        assert time.time() < deadline, "AsyncPoW.drain lost hashes"
+        time.sleep(0.01)
+        try:
+            pool.drain()
+        except asyncio.InvalidStateError:
+            errors += 1
+    assert errors == 1 and [f.result() for f in futures[1:]] == [expected[i:i + 40] for i in range(40, len(expected), 40)]
+    pool.close()
+    loop.close()
+    print('AsyncPoW OK')
+
+def _test_incremental(header_bin):
+    data = header_bin * 40
+    h = kshake320_hash.shake320(header_bin)
+    prefix = h.copy()
+    h.update(data)
+    assert h.digest(40) == kshake320_hash.getHash320(header_bin + data)
+    prefix.update(bytearray(data))
+    assert prefix.hexdigest(40) == binascii.hexlify(h.digest(40)).decode('ascii')
+    assert h.read(40) + h.read(60) == prefix.digest(100)
+
+    out = bytearray(41)
+    assert kshake320_hash.getHash320(data, out=out) is out and bytes(out[:40]) == kshake320_hash.getHash320(data)
+    out = bytearray(32)
+    assert kshake320_hash.getHash256(memoryview(data), out=out) is out and bytes(out) == kshake320_hash.getHash256(data)
+
+    # Keccak[c=640] of 'abc' with the SHA-3 domain suffix
+    assert kshake320_hash.sha3_320(b'abc').hexdigest() == '582f4f18fc093a397c330c980caa80e967e0e1478643aac4f7ae63379ba3a8f9d1a4f08fe8a7ac2c'
+    print('shake320/sha3_320 OK')
+
+def _test_bitcoin_hashes():
+    import hashlib
+    data = [b'', b'abc', b'a' * 55, b'a' * 56, b'a' * 64, b'a' * 1000]
+    for d in data:
+        sha256d = hashlib.sha256(hashlib.sha256(d).digest()).digest()
+        assert kshake320_hash.getSHA256d(d) == sha256d
+        try:
+            hash160 = hashlib.new('ripemd160', hashlib.sha256(d).digest()).digest()
+        except ValueError:
+            continue
+        assert kshake320_hash.getHash160(bytearray(d)) == hash160
+    # Hash160 of the compressed public key of private key 1
+    pubkey = binascii.unhexlify('0279be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798')
+    assert binascii.hexlify(kshake320_hash.getHash160(pubkey)) == b'751e76e8199196d454941c45d1b3a323f1433bd6'
+    out = bytearray(32)
+    assert kshake320_hash.getSHA256d(b'abc', out=out) is out and bytes(out) == kshake320_hash.getSHA256d(b'abc')
+    print('getSHA256d/getHash160 OK')
+
+def _test_stats(header_bin):
+    before = kshake320_hash.stats()
+    if before is None:
+        return
+    header_v2 = struct.pack("<i", 2) + header_bin[4:]
+    kshake320_hash.getPoWHash(header_bin)
+    kshake320_hash.getPoWHash(header_v2)
+    after = kshake320_hash.stats()
+    for phase in ('v1_absorb', 'v1_squeeze_absorb', 'v1_final_squeeze', 'v2_absorb', 'v2_squeeze', 'v2_reversed_absorb', 'v2_final_squeeze'):
+        assert after[phase]['hashes'] > before[phase]['hashes'], phase
+        for counter in ('cycles', 'instructions', 'l1d_misses', 'llc_misses', 'task_clock_ns'):
+            assert after[phase][counter] is None or after[phase][counter] >= before[phase][counter]
+    print('stats OK')
+
+def _test_metrics(header_bin):
+    kshake320_hash.reset_metrics()
+    header_v2 = struct.pack("<i", 2) + header_bin[4:120]
+    kshake320_hash.getPoWHash(header_bin)
+    kshake320_hash.getPoWHashBatch(header_bin[:120] + header_v2, 2)
+    kshake320_hash.getHash256(b'a' * 100)
+    kshake320_hash.getHash320(b'abc')
+    kshake320_hash.PowJob(header_v2).scan(0, 3, 0)
+    searcher = kshake320_hash.NonceSearcher(threads=2)
+    searcher.search(header_bin, 116, 0, 100, 0)
+    searcher.close()
+    metrics = kshake320_hash.metrics()
+    assert metrics['pow_hashes'] == {'v1': 102, 'v2': 4}
+    entries = metrics['entries']
+    assert entries['NonceSearcher.search']['calls'] == 1 and entries['NonceSearcher.search']['bytes'] == 12000
+    assert entries['getPoWHash']['calls'] == 1 and entries['getPoWHash']['bytes'] == 120
+    assert entries['getPoWHashBatch']['bytes'] == 240 and entries['PowJob.scan']['bytes'] == 360
+    assert entries['getHash256']['calls'] == 1 and entries['getHash256']['bytes'] == 100
+    assert sum(entries['getHash320']['latency']) == 1 and entries['getSHA256d']['calls'] == 0
+    assert metrics['ticks_per_second'] > 0
+    kshake320_hash.reset_metrics()
+    assert kshake320_hash.metrics()['pow_hashes'] == {'v1': 0, 'v2': 0}
+    print('metrics OK')
+
+def _test_threads(header_bin):
+    # Many threads hashing at once, some of them feeding one shared object
+    import threading
+    nthreads, rounds = 16, 8
+    headers = [struct.pack("<i", 1 + i % 2) + header_bin[4:116] + struct.pack("<I", i) for i in range(nthreads)]
+    expected = [kshake320_hash.getPoWHash(h) for h in headers]
+    chunks = [header_bin * 20, header_bin]
+    shared = kshake320_hash.shake320()
+    errors = []
+
+    def worker(i):
+        try:
+            job = kshake320_hash.PowJob(headers[i])
+            for r in range(rounds):
+                assert kshake320_hash.getPoWHash(headers[i]) == expected[i]
+                assert job.hash(i) == expected[i]
+                assert kshake320_hash.getHash320(chunks[0]) == kshake320_hash.shake320(chunks[0]).digest(40)
+                shared.update(chunks[r % 2])
+                shared.copy().digest(40)
+        except Exception as e:
+            errors.append(e)
+
+    threads = [threading.Thread(target=worker, args=(i,)) for i in range(nthreads)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    assert not errors, errors
+    # Updates are atomic, and all the chunks of a round are the same data
+    expected_shared = kshake320_hash.shake320(b''.join(chunks) * (nthreads * rounds // 2)).digest(40)
+    assert shared.digest(40) == expected_shared
+
+    # An update racing with the first read() either goes in before it or
+    # raises, never dropping its data silently
+    data = header_bin * 10000
+    after = kshake320_hash.shake320(data).digest(40)
+    for i in range(20):
+        h = kshake320_hash.shake320()
+        outcome = []
+        def update():
+            try:
+                h.update(data)
+                outcome.append('absorbed')
+            except ValueError:
+                outcome.append('refused')
+        t = threading.Thread(target=update)
+        t.start()
+        squeezed = h.read(40)
+        t.join()
+        assert (outcome, squeezed) in ((['absorbed'], after), (['refused'], kshake320_hash.shake320().digest(40))), outcome
+    print('threads OK')
+
+def _test_subinterpreter(header_bin):
+    try:
+        import _interpreters as interpreters
+    except ImportError:
+        try:
+            import _xxsubinterpreters as interpreters
+        except ImportError:
+            return
+    import os
+    interp = interpreters.create()
+    try:
+        interpreters.run_string(interp, "import binascii, sys\n"
+            "sys.path.insert(0, %r)\n"
+            "import kshake320_hash\n"
+            "assert kshake320_hash.getPoWHash(binascii.unhexlify('%s')) == binascii.unhexlify('%s')\n"
+            "assert kshake320_hash.shake320(b'abc').digest(40) == kshake320_hash.getHash320(b'abc')\n"
+            % (os.path.dirname(os.path.abspath(kshake320_hash.__file__)), binascii.hexlify(header_bin).decode('ascii'), binascii.hexlify(kshake320_hash.getPoWHash(header_bin)).decode('ascii')))
+    finally:
+        interpreters.destroy(interp)
+    print('subinterpreter OK')
 
 def uint320_from_str(s):
-    r = 0L
+    r = 0
     t = struct.unpack("<IIIIIIIIII", s[:40])
-    for i in xrange(10):
+    for i in range(10):
         r += t[i] << (i * 32)
-    return r   
+    return r
+
+def uint320_to_str(n):
+    return struct.pack("<IIIIIIIIII", *[(n >> (i * 32)) & 0xffffffff for i in range(10)])
 
 if __name__ == '__main__':
     import binascii
     import struct
-    import kshake320_hash 
+    import time
+    import kshake320_hash
     _test()
 
-
@@ -0,0 +1,320 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Differential tests of the Keccak backends against the scalar one, the
+// reference, on inputs of any length and bit length. Each input gives:
+//
+//   byte 0     the sponge: SHA3-224/256/384/512, SHAKE128/256 or SHAKE320
+//   byte 1     bits dropped from the last byte of the message, 0 to 7
+//   bytes 2-3  bytes squeezed, 1 to 1024, little-endian
+//   byte 4     seed of the lengths of the updates and of the squeezes
+//   byte 5     bit 0: hash the message as 120-byte PoW headers as well,
+//              bits 1-7: the nonce offset of the midstate, modulo 117
+//   the rest   the message
+//
+// For the scalar backend, the message hashed in one update must give what
+// it gives in updates of random lengths, and every other backend must give
+// the same bits as the scalar one, as must its fast loops applied to the
+// message directly. Up to 9 headers, which leave a partial group in the
+// kernels of 4 and 8 states, are hashed by KSHAKE320POWBatch and compared
+// with KSHAKE320POW of each one under the scalar backend, and the midstate
+// of the first one with KSHAKE320POW. The version of each header is its
+// first byte modulo 3, the rest of the int32 being cleared, which gives v1
+// and v2 headers.
+//
+// With KSHAKE320_LIBFUZZER defined, this is the entry point of a libFuzzer
+// target (CMake option KSHAKE320_LIBFUZZER, Clang). Otherwise main() runs
+// the files given on the command line, a corpus for instance, or inputs
+// from a seeded generator:
+//
+//   usage: kshake320_fuzz [--runs n] [--seed s] [file...]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+// Without C linkage of its own, and included by pow.h through KeccakHash.h
+extern "C" {
+#include "keccak/KeccakF-1600/KeccakF-1600-interface.h"
+}
+#include "keccak/KeccakHash.h"
+#include "keccak/sha3.h"
+#include "kshake320/pow.h"
+#ifdef USE_KECCAK_DISPATCH
+#include "keccak/KeccakF-1600/Dispatch/KeccakF-1600-dispatch.h"
+#endif
+
+namespace {
+
+struct Sponge
+{
+    unsigned int rate;
+    unsigned int capacity;
+    unsigned char suffix;
+};
+
+const Sponge sponges[] = {
+    { 1152, 448, 0x06 }, { 1088, 512, 0x06 }, { 832, 768, 0x06 }, { 576, 1024, 0x06 },
+    { 1344, 256, 0x1F }, { 1088, 512, 0x1F }, { SHAKE320_R, SHAKE320_C, SHAKE320_P },
+};
+
+const size_t maxHeaders = 9;
+
+struct Params
+{
+    const Sponge *sponge;
+    const unsigned char *message;
+    size_t bits;
+    size_t outLen;
+    uint32_t seed;
+    bool pow;
+    unsigned int nonceOffset;
+};
+
+// Aborts, so that libFuzzer keeps the input, with what differed.
+void Mismatch(const char *what, const char *backend)
+{
+    fprintf(stderr, "mismatch: %s with the %s backend\n", what, backend);
+    abort();
+}
+
+// xorshift32, for lengths that depend on the input only
+uint32_t Next(uint32_t &x)
+{
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+// Hashes the message with the active backend, in one update and squeeze if
+// seed is 0, otherwise in pieces of random lengths.
+std::vector<unsigned char> Hash(const Params &p, uint32_t seed)
+{
+    Keccak_HashInstance h;
+    Keccak_HashInitialize(&h, p.sponge->rate, p.sponge->capacity, 0, p.sponge->suffix);
+    const unsigned char *data = p.message;
+    size_t bits = p.bits;
+    // Whole bytes but for the last update, up to three blocks long
+    const size_t maxStep = 3 * p.sponge->rate / 8 + 1;
+    while (seed != 0 && bits > 0) {
+        size_t step = 8 * (Next(seed) % maxStep);
+        if (step >= bits)
+            break;
+        Keccak_HashUpdate(&h, data, step);
+        data += step / 8;
+        bits -= step;
+    }
+    Keccak_HashUpdate(&h, data, bits);
+    Keccak_HashFinal(&h, NULL);
+
+    std::vector<unsigned char> out(p.outLen);
+    for (size_t done = 0; done < p.outLen; ) {
+        size_t step = seed == 0 ? p.outLen : 1 + Next(seed) % maxStep;
+        step = std::min(step, p.outLen - done);
+        Keccak_HashSqueeze(&h, &out[done], 8 * step);
+        done += step;
+    }
+    return out;
+}
+
+struct PoWHashes
+{
+    std::vector<char> batch;
+    std::vector<char> midstate;
+};
+
+PoWHashes HashHeaders(const Params &p, const std::vector<char> &headers, size_t count)
+{
+    PoWHashes hashes;
+    hashes.batch.resize(count * 40);
+    hashes.midstate.resize(40);
+    KSHAKE320POWBatch(&headers[0], count, &hashes.batch[0]);
+    uint32_t nonce;
+    memcpy(&nonce, &headers[p.nonceOffset], 4);
+    KSHAKE320Midstate midstate(&headers[0], p.nonceOffset);
+    midstate.Hash(nonce, &hashes.midstate[0]);
+    return hashes;
+}
+
+#ifdef USE_KECCAK_DISPATCH
+// The fast loops of the backend applied to the message: what they process,
+// what is squeezed and the states they leave, the absorbing one of
+// SqueezeAbsorb last. The state starts with the first bytes of the message
+// so that its lanes are not all zero.
+struct Loops
+{
+    size_t absorbed;
+    size_t squeezed;
+    size_t squeezeAbsorbed;
+    std::vector<unsigned char> out;
+    std::vector<unsigned char> states;
+
+    bool operator!=(const Loops &other) const
+    {
+        return absorbed != other.absorbed || squeezed != other.squeezed || squeezeAbsorbed != other.squeezeAbsorbed
+            || out != other.out || states != other.states;
+    }
+};
+
+Loops RunLoops(const KeccakF1600_Backend *b, const Params &p)
+{
+    const unsigned int laneCount = p.sponge->rate / 64;
+    const size_t len = p.bits / 8;
+    alignas(64) unsigned char state[KeccakF_stateSizeInBytes];
+    alignas(64) unsigned char absorbState[KeccakF_stateSizeInBytes];
+    KeccakF1600_StateInitialize(state);
+    KeccakF1600_StateInitialize(absorbState);
+    memcpy(state, p.message, std::min(len, sizeof(state)));
+
+    Loops loops;
+    loops.absorbed = b->FBWL_Absorb(state, laneCount, p.message, len, p.sponge->suffix);
+    loops.out.resize(p.outLen);
+    loops.squeezed = b->FBWL_Squeeze(state, laneCount, &loops.out[0], p.outLen);
+    loops.squeezeAbsorbed = b->FBWL_SqueezeAbsorb(state, absorbState, laneCount, p.outLen);
+    loops.states.assign(state, state + sizeof(state));
+    loops.states.insert(loops.states.end(), absorbState, absorbState + sizeof(absorbState));
+    return loops;
+}
+#endif
+
+void Run(const unsigned char *data, size_t size)
+{
+    if (size < 6)
+        return;
+    Params p;
+    p.sponge = &sponges[data[0] % (sizeof(sponges) / sizeof(sponges[0]))];
+    p.message = data + 6;
+    const size_t len = size - 6;
+    p.bits = len == 0 ? 0 : 8 * len - data[1] % 8;
+    p.outLen = 1 + (data[2] | (data[3] << 8)) % 1024;
+    p.seed = 0x9E3779B9u ^ (data[4] * 0x01010101u);
+    p.pow = (data[5] & 1) != 0 && len >= 120;
+    p.nonceOffset = (data[5] >> 1) % 117;
+
+    // The headers, with the versions cleared but for the first byte
+    const size_t count = p.pow ? std::min(len / 120, maxHeaders) : 0;
+    std::vector<char> headers(p.message, p.message + count * 120);
+    for (size_t i = 0; i < count; i++) {
+        char *header = &headers[i * 120];
+        header[0] = (char)((unsigned char)header[0] % 3);
+        header[1] = header[2] = header[3] = 0;
+    }
+
+#ifdef USE_KECCAK_DISPATCH
+    const KeccakF1600_Backend *active = KeccakF1600_ActiveBackend;
+    KeccakF1600_DispatchSelect("scalar");
+    const KeccakF1600_Backend *scalar = KeccakF1600_ActiveBackend;
+#endif
+
+    const std::vector<unsigned char> reference = Hash(p, 0);
+    if (Hash(p, p.seed) != reference)
+        Mismatch("the sponge in pieces", "scalar");
+    PoWHashes pow;
+    if (count > 0) {
+        pow.batch.resize(count * 40);
+        for (size_t i = 0; i < count; i++)
+            KSHAKE320POW(&headers[i * 120], &pow.batch[i * 40]);
+        pow.midstate.assign(pow.batch.begin(), pow.batch.begin() + 40);
+        if (HashHeaders(p, headers, count).midstate != pow.midstate)
+            Mismatch("KSHAKE320Midstate", "scalar");
+    }
+
+#ifdef USE_KECCAK_DISPATCH
+    const Loops loops = RunLoops(scalar, p);
+    static const char *const names[] = { "avx2", "avx512" };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (KeccakF1600_DispatchSelect(names[i]) != 0)
+            continue;
+        if (Hash(p, 0) != reference)
+            Mismatch("the sponge", names[i]);
+        if (Hash(p, p.seed) != reference)
+            Mismatch("the sponge in pieces", names[i]);
+        if (RunLoops(KeccakF1600_ActiveBackend, p) != loops)
+            Mismatch("the fast loops", names[i]);
+        if (count > 0) {
+            PoWHashes hashes = HashHeaders(p, headers, count);
+            if (hashes.batch != pow.batch)
+                Mismatch("KSHAKE320POWBatch", names[i]);
+            if (hashes.midstate != pow.midstate)
+                Mismatch("KSHAKE320Midstate", names[i]);
+        }
+    }
+    KeccakF1600_ActiveBackend = active;
+#else
+    // A single backend: the batch against the headers one by one
+    if (count > 0 && HashHeaders(p, headers, count).batch != pow.batch)
+        Mismatch("KSHAKE320POWBatch", KSHAKE320Backend());
+#endif
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    Run(data, size);
+    return 0;
+}
+
+#ifndef KSHAKE320_LIBFUZZER
+
+int main(int argc, char **argv)
+{
+    unsigned long runs = 2000;
+    uint32_t seed = 1;
+    std::vector<const char *> files;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+            runs = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            seed = (uint32_t)strtoul(argv[++i], NULL, 10) | 1;
+        else if (argv[i][0] == '-') {
+            fprintf(stderr, "usage: %s [--runs n] [--seed s] [file...]\n", argv[0]);
+            return 2;
+        }
+        else
+            files.push_back(argv[i]);
+    }
+
+    for (size_t i = 0; i < files.size(); i++) {
+        FILE *f = fopen(files[i], "rb");
+        if (f == NULL) {
+            perror(files[i]);
+            return 1;
+        }
+        std::vector<uint8_t> input;
+        uint8_t buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+            input.insert(input.end(), buffer, buffer + n);
+        fclose(f);
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+    }
+    if (!files.empty()) {
+        printf("%u inputs OK\n", (unsigned int)files.size());
+        return 0;
+    }
+
+    // Mostly short messages, around the rates; PoW headers in one input in 16
+    std::vector<uint8_t> input;
+    for (unsigned long r = 0; r < runs; r++) {
+        const bool pow = Next(seed) % 16 == 0;
+        size_t size = 6;
+        if (pow)
+            size += 120 + Next(seed) % (maxHeaders * 120);
+        else
+            size += Next(seed) % (Next(seed) % 8 == 0 ? 2048 : 300);
+        input.resize(size);
+        for (size_t i = 0; i < size; i++)
+            input[i] = (uint8_t)Next(seed);
+        input[5] = (uint8_t)((input[5] & ~1) | (pow ? 1 : 0));
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+    }
+    printf("%lu inputs OK\n", runs);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,331 @@
+// Copyright (c) 2014 Chilean Krypto-Miners.
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Known-answer tests of libkshake320, run once for every Keccak backend the
+// build has and the CPU supports, so that a new backend has to give the same
+// bits as the others:
+//
+//   - the FIPS 202 SHA3 and SHAKE vectors, the messages of a bit length that
+//     is not a multiple of 8 included, hashed in one update, byte by byte
+//     and in uneven pieces, and squeezed likewise;
+//   - SHAKE320 and SHA3-320, the sponges of the PoW;
+//   - the PoW vectors of test.py, v1 and v2, through KSHAKE320POW, the
+//     batches of the parallel kernels and the midstate of a mining job.
+//
+// The builds without KSHAKE320_DISPATCH have a single permutation,
+// Optimized64 or, for 32-bit targets and with KSHAKE320_INPLACE32BI,
+// Inplace32BI, which these tests cover when run from such a build.
+//
+// usage: kshake320_kat
+// Prints the vectors that fail and exits with 1 if any did.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+// Without C linkage of its own, and included by pow.h through KeccakHash.h
+extern "C" {
+#include "keccak/KeccakF-1600/KeccakF-1600-interface.h"
+}
+#include "keccak/KeccakHash.h"
+#include "keccak/sha3.h"
+#include "kshake320/pow.h"
+#ifdef USE_KECCAK_DISPATCH
+#include "keccak/KeccakF-1600/Dispatch/KeccakF-1600-dispatch.h"
+#endif
+
+namespace {
+
+struct Sponge
+{
+    const char *name;
+    unsigned int rate;
+    unsigned int capacity;
+    unsigned char suffix;
+};
+
+const Sponge SHA3_224_Sponge = { "SHA3-224", 1152, 448, 0x06 };
+const Sponge SHA3_256_Sponge = { "SHA3-256", 1088, 512, 0x06 };
+const Sponge SHA3_384_Sponge = { "SHA3-384", 832, 768, 0x06 };
+const Sponge SHA3_512_Sponge = { "SHA3-512", 576, 1024, 0x06 };
+const Sponge SHAKE128_Sponge = { "SHAKE128", 1344, 256, 0x1F };
+const Sponge SHAKE256_Sponge = { "SHAKE256", 1088, 512, 0x1F };
+const Sponge SHAKE320_Sponge = { "SHAKE320", SHAKE320_R, SHAKE320_C, SHAKE320_P };
+
+// Message of bits bits: the bytes of hex repeated repeat times, the bits of
+// the last byte in its least significant ones.
+struct Vector
+{
+    const Sponge *sponge;
+    const char *hex;
+    size_t repeat;
+    size_t bits;
+    const char *expected;
+};
+
+// 200 times, the 1600-bit message of FIPS 202; the low 5 bits of one more
+// are the last ones of the 1605-bit message, its other bits being ignored
+#define KSHAKE320_A3 "a3"
+
+const Vector vectors[] = {
+    { &SHA3_224_Sponge, "", 1, 0, "6b4e03423667dbb73b6e15454f0eb1abd4597f9a1b078e3f5b5a6bc7" },
+    { &SHA3_224_Sponge, "616263", 1, 24, "e642824c3f8cf24ad09234ee7d3c766fc9a3a5168d0c94ad73b46fdf" },
+    { &SHA3_224_Sponge, KSHAKE320_A3, 200, 1600, "9376816aba503f72f96ce7eb65ac095deee3be4bf9bbc2a1cb7e11e0" },
+    { &SHA3_256_Sponge, "", 1, 0, "a7ffc6f8bf1ed76651c14756a061d662f580ff4de43b49fa82d80a4b80f8434a" },
+    { &SHA3_256_Sponge, "616263", 1, 24, "3a985da74fe225b2045c172d6bd390bd855f086e3e9d525b46bfe24511431532" },
+    { &SHA3_256_Sponge, KSHAKE320_A3, 200, 1600, "79f38adec5c20307a98ef76e8324afbfd46cfd81b22e3973c65fa1bd9de31787" },
+    { &SHA3_256_Sponge, "61", 1000000, 8000000, "5c8875ae474a3634ba4fd55ec85bffd661f32aca75c6d699d0cdcb6c115891c1" },
+    { &SHA3_384_Sponge, "", 1, 0,
+      "0c63a75b845e4f7d01107d852e4c2485c51a50aaaa94fc61995e71bbee983a2ac3713831264adb47fb6bd1e058d5f004" },
+    { &SHA3_384_Sponge, "616263", 1, 24,
+      "ec01498288516fc926459f58e2c6ad8df9b473cb0fc08c2596da7cf0e49be4b298d88cea927ac7f539f1edf228376d25" },
+    { &SHA3_384_Sponge, KSHAKE320_A3, 200, 1600,
+      "1881de2ca7e41ef95dc4732b8f5f002b189cc1e42b74168ed1732649ce1dbcdd76197a31fd55ee989f2d7050dd473e8f" },
+    { &SHA3_512_Sponge, "", 1, 0,
+      "a69f73cca23a9ac5c8b567dc185a756e97c982164fe25859e0d1dcc1475c80a6"
+      "15b2123af1f5f94c11e3e9402c3ac558f500199d95b6d3e301758586281dcd26" },
+    { &SHA3_512_Sponge, "616263", 1, 24,
+      "b751850b1a57168a5693cd924b6b096e08f621827444f70d884f5d0240d2712e"
+      "10e116e9192af3c91a7ec57647e3934057340b4cf408d5a56592f8274eec53f0" },
+    { &SHA3_512_Sponge, KSHAKE320_A3, 200, 1600,
+      "e76dfad22084a8b1467fcf2ffa58361bec7628edf5f3fdc0e4805dc48caeeca8"
+      "1b7c13c30adf52a3659584739a2df46be589c51ca1a4a8416df6545a1ce8ba00" },
+    { &SHAKE128_Sponge, "", 1, 0, "7f9c2ba4e88f827d616045507605853ed73b8093f6efbc88eb1a6eacfa66ef26" },
+    // Squeezed past the first block
+    { &SHAKE128_Sponge, KSHAKE320_A3, 200, 1600,
+      "131ab8d2b594946b9c81333f9bb6e0ce75c3b93104fa3469d3917457385da037cf232ef7164a6d1eb448c8908186ad85"
+      "2d3f85a5cf28da1ab6fe3438171978467f1c05d58c7ef38c284c41f6c2221a76f12ab1c04082660250802294fb871802"
+      "13fdef5b0ecb7df50ca1f8555be14d32e10f6edcde892c09424b29f597afc270c904556bfcb47a7d40778d390923642b"
+      "3cbd0579e60908d5a000c1d08b98ef933f806445bf87f8b009ba9e94f7266122ed7ac24e5e266c42a82fa1bbefb7b8db"
+      "0066e16a85e0493f" },
+    { &SHAKE256_Sponge, "", 1, 0,
+      "46b9dd2b0ba88d13233b3feb743eeb243fcd52ea62b81b82b50c27646ed5762f"
+      "d75dc4ddd8c0f200cb05019d67b592f6fc821c49479ab48640292eacb3b7c4be" },
+    { &SHAKE256_Sponge, KSHAKE320_A3, 200, 1600,
+      "cd8a920ed141aa0407a22d59288652e9d9f1a7ee0c1e7c1ca699424da84a904d2d700caae7396ece96604440577da4f3"
+      "aa22aeb8857f961c4cd8e06f0ae6610b1048a7f64e1074cd629e85ad7566048efc4fb500b486a3309a8f26724c0ed628"
+      "001a1099422468de726f1061d99eb9e93604d5aa7467d4b1bd6484582a384317d7f47d750b8f5499512bb85a226c4243"
+      "556e696f6bd072c5aa2d9b69730244b56853d16970ad817e213e470618178001c9fb56c54fefa5fee67d2da524bb3b0b"
+      "61ef0e9114a92cdb" },
+    // Bit lengths: 5, 30 and 1605 bits from the FIPS 202 examples
+    { &SHA3_256_Sponge, "13", 1, 5, "7b0047cf5a456882363cbf0fb05322cf65f4b7059a46365e830132e3b5d957af" },
+    { &SHA3_256_Sponge, "53587b19", 1, 30, "c8242fef409e5ae9d1f1c857ae4dc624b92b19809f62aa8c07411c54a078b1d0" },
+    { &SHA3_224_Sponge, KSHAKE320_A3, 201, 1605, "22d2f7bb0b173fd8c19686f9173166e3ee62738047d7eadd69efb228" },
+    // SHAKE320, from a plain implementation of the sponge
+    { &SHAKE320_Sponge, "", 1, 0,
+      "54aafbbdb40ad4b814bf69148ef24f95afa3e63f4b542c1e7fb1ba125e4e71e501e4e70f5bf866cf" },
+    { &SHAKE320_Sponge, "616263", 1, 24,
+      "ae78496cb927ebe368f10f2ddd77135bf4424ebbb08bd3d4ce0a981e4a9f05aaa0c3e9a6a3a2364d" },
+    { &SHAKE320_Sponge, "13", 1, 5,
+      "c89886f4f68b45f65a65dacf34ee7de0df0e311bb8e774e60dca7ccbdacc0a74db81d5bf318fc3c0" },
+    { &SHAKE320_Sponge, KSHAKE320_A3, 201, 1605,
+      "251644522aa1fa9294df31e08b667341482334172f63615b2db2186886609d1a074e424fcfef7888" },
+    { &SHAKE320_Sponge, KSHAKE320_A3, 200, 1600,
+      "5b359af79c19b7510df103a94df5ccb85cb481abe33cdbce336891c3a9bf0f591e06a66ffe88bae178b056b81f84e3a6"
+      "d0aad78452ed5aa8b88950c079772796e906d738cb6d200e3b4c1c40662b60c767ca94594cb13e97a13864ce7e13d890"
+      "43f1af497a227d7657bcb4a372e69b9670e1e7aae25d1dd672e35ff6ced9a7533181218f0e07de4441796b7394ebd19e"
+      "ef5e4a8e283b49e9ea7a67c627fa62624952bf8615fbb28af40e106c1098cd1719cbf53331085538fc5951e1828518ce"
+      "d70bd4a2607d4148ab59b6bf8e73a497fee15f5150ba8e6576c9303254ee0a471d1de7735ee9c1bf6f3491001ec5bbbb"
+      "36b99a94d03f7199334bcd700630bff1" },
+};
+
+// The header of test.py, a v1 one, and the same with version 2. The hashes
+// are the bytes written by KSHAKE320POW, test.py showing the v1 one reversed.
+const char *const powHeaderV1 =
+    "0100000000000000cb43b0ec8ef4464f3d041493689274ee53741586acf0ad0b94b0d0986928165fd9823edff8000000"
+    "917e5ee9f277da18cb60d7a3b3bf5cb3edf82a559f63de9ab5684405e382b69205139b983ea68fb20000000000000000"
+    "000000000000000000000000ffff0026179cfb0343ff1400";
+const char *const powHashV1 =
+    "dd9db1d84b0abcd3ffc46765cf16300d13adf3c61a72534a0aeb2a8ca719c1eee7fe687cbc000000";
+const char *const powHashV2 =
+    "1c9293dea0633c2452fb6b807046ae2d1eca0bab3ad68a285d96ff05c7bd5e9d6ca5b06873f7c8a0";
+
+std::string FromHex(const char *hex)
+{
+    std::string bytes;
+    for (size_t i = 0; hex[i] != 0 && hex[i + 1] != 0; i += 2) {
+        unsigned int byte;
+        sscanf(hex + i, "%2x", &byte);
+        bytes.push_back((char)byte);
+    }
+    return bytes;
+}
+
+std::string ToHex(const unsigned char *data, size_t len)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    for (size_t i = 0; i < len; i++) {
+        hex.push_back(digits[data[i] >> 4]);
+        hex.push_back(digits[data[i] & 15]);
+    }
+    return hex;
+}
+
+class Checker
+{
+public:
+    Checker(const char *backend) : backend(backend), checks(0), failures(0) {}
+
+    void Check(const std::string &name, const std::string &expectedHex, const unsigned char *got, size_t len)
+    {
+        checks++;
+        std::string gotHex = ToHex(got, len);
+        if (gotHex != expectedHex) {
+            failures++;
+            printf("FAIL %s %s\n  expected %s\n  got      %s\n", backend, name.c_str(), expectedHex.c_str(), gotHex.c_str());
+        }
+    }
+
+    const char *backend;
+    unsigned int checks;
+    unsigned int failures;
+};
+
+// The message of v hashed in updates of step bits, 0 for all of them at
+// once, and squeezed in pieces of squeezeStep bytes.
+std::vector<unsigned char> Hash(const Vector &v, const std::string &message, size_t step, size_t squeezeStep, size_t outLen)
+{
+    Keccak_HashInstance h;
+    Keccak_HashInitialize(&h, v.sponge->rate, v.sponge->capacity, 0, v.sponge->suffix);
+    const unsigned char *data = (const unsigned char *)message.data();
+    size_t bits = v.bits;
+    while (step != 0 && bits > step) {
+        Keccak_HashUpdate(&h, data, step);
+        data += step / 8;
+        bits -= step;
+    }
+    Keccak_HashUpdate(&h, data, bits);
+    Keccak_HashFinal(&h, NULL);
+
+    std::vector<unsigned char> out(outLen);
+    for (size_t done = 0; done < outLen; done += squeezeStep)
+        Keccak_HashSqueeze(&h, &out[done], 8 * std::min(squeezeStep, outLen - done));
+    return out;
+}
+
+void CheckSponges(Checker &checker)
+{
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        const Vector &v = vectors[i];
+        std::string message;
+        for (size_t r = 0; r < v.repeat; r++)
+            message += FromHex(v.hex);
+        const size_t outLen = strlen(v.expected) / 2;
+        char name[64];
+        snprintf(name, sizeof(name), "%s(%u bits)", v.sponge->name, (unsigned int)v.bits);
+
+        std::vector<unsigned char> out = Hash(v, message, 0, outLen, outLen);
+        checker.Check(name, v.expected, out.data(), outLen);
+        // Byte by byte goes through the partial blocks only; 13 bytes at a
+        // time mixes them with the fast loop, here with the whole blocks.
+        // Not for the million bytes, which the first update takes care of.
+        if (v.repeat < 1000) {
+            out = Hash(v, message, 8, 1, outLen);
+            checker.Check(std::string(name) + " byte by byte", v.expected, out.data(), outLen);
+        }
+        out = Hash(v, message, 13 * 8, 7, outLen);
+        checker.Check(std::string(name) + " in pieces", v.expected, out.data(), outLen);
+    }
+
+    // The one-shot functions of sha3.h; test.py has the SHA3-320 one
+    unsigned char md[64];
+    SHA3_320((const unsigned char *)"abc", 3, md);
+    checker.Check("SHA3_320(abc)", "582f4f18fc093a397c330c980caa80e967e0e1478643aac4f7ae63379ba3a8f9d1a4f08fe8a7ac2c", md, 40);
+    SHAKE320((const unsigned char *)"abc", 24, md, 40);
+    checker.Check("SHAKE320(abc)", "ae78496cb927ebe368f10f2ddd77135bf4424ebbb08bd3d4ce0a981e4a9f05aaa0c3e9a6a3a2364d", md, 40);
+    SHA3_256((const unsigned char *)"abc", 3, md);
+    checker.Check("SHA3_256(abc)", "3a985da74fe225b2045c172d6bd390bd855f086e3e9d525b46bfe24511431532", md, 32);
+}
+
+void CheckPoW(Checker &checker)
+{
+    std::string v1 = FromHex(powHeaderV1);
+    std::string v2 = v1;
+    v2[0] = 2;
+    unsigned char out[40];
+    KSHAKE320POW(v1.data(), (char *)out);
+    checker.Check("KSHAKE320POW v1", powHashV1, out, 40);
+    KSHAKE320POW(v2.data(), (char *)out);
+    checker.Check("KSHAKE320POW v2", powHashV2, out, 40);
+
+    // Enough headers for two groups of the widest kernel and a partial one,
+    // v1 and v2 mixed, the two vectors first
+    const size_t count = 19;
+    std::string headers;
+    std::vector<std::string> expected;
+    for (size_t i = 0; i < count; i++) {
+        std::string header = i % 2 ? v2 : v1;
+        if (i >= 2)
+            KSHAKE320SetNonce(&header[0], 116, (uint32_t)i);
+        headers += header;
+        KSHAKE320POW(header.data(), (char *)out);
+        expected.push_back(ToHex(out, 40));
+    }
+    expected[0] = powHashV1;
+    expected[1] = powHashV2;
+    std::vector<unsigned char> outputs(count * 40);
+    KSHAKE320POWBatch(headers.data(), count, (char *)outputs.data());
+    for (size_t i = 0; i < count; i++) {
+        char name[64];
+        snprintf(name, sizeof(name), "KSHAKE320POWBatch header %u", (unsigned int)i);
+        checker.Check(name, expected[i], &outputs[i * 40], 40);
+    }
+
+    // The nonce over the version, where it sets the version of each header,
+    // right after it, in the middle of the header and at its end, where the
+    // midstate has all the other bytes absorbed
+    static const unsigned int nonceOffsets[] = { 0, 2, 4, 40, 116 };
+    static const uint32_t nonces[] = { 0, 1, 0x12345678 };
+    for (size_t i = 0; i < sizeof(nonceOffsets) / sizeof(nonceOffsets[0]); i++) {
+        for (int v = 1; v <= 2; v++) {
+            const unsigned int offset = nonceOffsets[i];
+            KSHAKE320Midstate midstate((v == 1 ? v1 : v2).data(), offset);
+            for (size_t k = 0; k < sizeof(nonces) / sizeof(nonces[0]); k++) {
+                std::string header = v == 1 ? v1 : v2;
+                KSHAKE320SetNonce(&header[0], offset, nonces[k]);
+                KSHAKE320POW(header.data(), (char *)out);
+                std::string expectedHash = ToHex(out, 40);
+                midstate.Hash(nonces[k], (char *)out);
+                char name[80];
+                snprintf(name, sizeof(name), "KSHAKE320Midstate v%d nonce %08x at %u", v, nonces[k], offset);
+                checker.Check(name, expectedHash, out, 40);
+            }
+        }
+    }
+}
+
+// Runs the tests with the active backend; returns the number of failures.
+unsigned int Run(const char *backend)
+{
+    Checker checker(backend);
+    CheckSponges(checker);
+    CheckPoW(checker);
+    printf("%s: %u of %u checks passed\n", backend, checker.checks - checker.failures, checker.checks);
+    return checker.failures;
+}
+
+}  // namespace
+
+int main()
+{
+    unsigned int failures = 0;
+#ifdef USE_KECCAK_DISPATCH
+    static const char *const names[] = { "scalar", "avx2", "avx512" };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (KeccakF1600_DispatchSelect(names[i]) != 0) {
+            printf("%s: not supported by this CPU, skipped\n", names[i]);
+            continue;
+        }
+        failures += Run(names[i]);
+    }
+#elif defined(USE_KECCAK64)
+    failures += Run("Optimized64");
+#else
+    failures += Run("Inplace32BI");
+#endif
+    return failures == 0 ? 0 : 1;
+}